@@ -0,0 +1,248 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+// microbenchmarks of the pieces of the propagation, each is run until it
+// took --seconds and reported in ns and allocations per operation
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "commandlineparser.h"
+#include "layer.h"
+#include "lrucache.h"
+#include "permutation.h"
+#include "permutation_list.h"
+#include "random.h"
+#include "step_nonlinear.h"
+
+static uint64_t allocations = 0;
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  void* memory = std::malloc(size ? size : 1);
+  if (memory == nullptr)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+struct MicroResult {
+  double ns_;
+  double allocations_;
+};
+
+static double min_seconds = 0.2;
+static volatile uint64_t sink = 0;
+
+// doubles the number of operations until they take long enough
+template <typename OP>
+MicroResult Measure(OP op) {
+  for (uint64_t iterations = 1;; iterations *= 2) {
+    uint64_t allocations_before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+      op();
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (seconds >= min_seconds)
+      return MicroResult { seconds * 1e9 / iterations,
+          double(allocations - allocations_before) / iterations };
+  }
+}
+
+static void Print(const std::string& name, const std::string& detail,
+                  MicroResult result) {
+  std::cout << std::left << std::setw(28) << name << std::setw(24) << detail
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << result.ns_ << std::setprecision(2)
+            << std::setw(12) << result.allocations_ << std::endl;
+}
+
+// the operation minus the resetting of its input, which the baseline does
+template <typename OP, typename BASELINE>
+static void PrintNet(const std::string& name, const std::string& detail,
+                     OP op, BASELINE baseline) {
+  MicroResult total = Measure(op);
+  MicroResult reset = Measure(baseline);
+  Print(name, detail, MicroResult { std::max(0.0, total.ns_ - reset.ns_),
+      std::max(0.0, total.allocations_ - reset.allocations_) });
+}
+
+// all pairs of input and output masks over {0, 1, ?}
+template <unsigned bits, unsigned boxes>
+static void BenchNonlinearStep(const std::string& target, Permutation* perm) {
+  auto* layer =
+      dynamic_cast<SboxLayer<bits, boxes>*>(perm->sbox_layers_[0].get());
+  NonlinearStep<bits> step = layer->sboxes[0];
+  std::vector<Mask> patterns;
+  unsigned int count = 1;
+  for (unsigned int i = 0; i < bits; ++i)
+    count *= 3;
+  for (unsigned int p = 0; p < count; ++p) {
+    WordMask word(bits);
+    for (unsigned int i = 0, rest = p; i < bits; ++i, rest /= 3)
+      word[i] = rest % 3 == 0 ? BM_0 : (rest % 3 == 1 ? BM_1 : BM_DUNNO);
+    patterns.emplace_back(word);
+  }
+
+  Mask x(bits), y(bits);
+  uint64_t pair = 0;
+  auto reset = [&] () {
+    x = patterns[pair % count];
+    y = patterns[(pair / count) % count];
+    pair++;
+  };
+  PrintNet("NonlinearStep<" + std::to_string(bits) + ">::Update",
+           target + ", all patterns",
+           [&] () { reset(); sink += step.Update(x, y); }, reset);
+}
+
+static void BenchLinearLayer(const std::string& target, Permutation* perm) {
+  Xoshiro256 generator(1);
+  for (double share : { 0.0, 0.25, 0.5, 1.0 }) {
+    std::unique_ptr<Permutation> copy(perm->clone());
+    LinearLayer* layer = copy->linear_layers_[0].get();
+    std::unique_ptr<LinearLayer> prototype(layer->clone());
+    std::bernoulli_distribution determined(share);
+    for (unsigned int w = 0; w < layer->in->getnumwords(); ++w)
+      for (unsigned int b = 0; b < layer->in->getnumbits(); ++b)
+        if (determined(generator))
+          layer->in->SetBit(generator() & 1 ? BM_1 : BM_0, w, b);
+    std::unique_ptr<StateMaskBase> in(layer->in->clone());
+    std::unique_ptr<StateMaskBase> out(layer->out->clone());
+    auto reset = [&] () {
+      layer->in->copyValues(in.get());
+      layer->out->copyValues(out.get());
+      layer->copyValues(prototype.get());
+    };
+    PrintNet("LinearLayer::Update",
+             target + ", " + std::to_string(int(share * 100)) + "% known",
+             [&] () { reset(); sink += layer->Update(); }, reset);
+  }
+}
+
+static void BenchStateMask(const std::string& target, Permutation* perm) {
+  StateMaskBase* mask = perm->state_masks_[0].get();
+  std::unique_ptr<StateMaskBase> copy(mask->clone());
+  Print("StateMask::clone", target, Measure([&] () {
+    std::unique_ptr<StateMaskBase> clone(mask->clone());
+    sink += clone->getnumwords();
+  }));
+  Print("StateMask::copyValues", target, Measure([&] () {
+    copy->copyValues(mask);
+  }));
+}
+
+static void BenchVerticalMask(const std::string& target, Permutation* perm) {
+  SboxLayerBase* layer = perm->sbox_layers_[0].get();
+  unsigned int boxes = layer->GetNumSteps();
+  Mask box = layer->GetVerticalMask(0, *layer->in);
+  unsigned int b = 0;
+  Print("GetVerticalMask", target, Measure([&] () {
+    Mask mask = layer->GetVerticalMask(b++ % boxes, *layer->in);
+    sink += mask.bitsize_;
+  }));
+  Print("SetVerticalMask", target, Measure([&] () {
+    layer->SetVerticalMask(b++ % boxes, *layer->in, box);
+  }));
+}
+
+static void BenchSaveRestore(const std::string& target, Permutation* perm) {
+  std::unique_ptr<Permutation> copy(perm->clone());
+  copy->save();
+  Print("Permutation::save", target, Measure([&] () { copy->save(); }));
+  Print("Permutation::restore", target, Measure([&] () { copy->restore(); }));
+}
+
+// a full cache, so every insert first evicts the oldest entry
+static void BenchLruCache() {
+  const unsigned int size = 0x1000;
+  LRU_Cache<unsigned long long, NonlinearStepUpdateInfo> cache(size);
+  NonlinearStepUpdateInfo info { true, false, WordMask(5, BM_1),
+      WordMask(5, BM_0) };
+  for (unsigned long long key = 0; key < size; ++key)
+    cache.insert(key, info);
+  unsigned long long key = 0;
+  Print("LRU_Cache::find", "hit, full cache", Measure([&] () {
+    sink += cache.find(key++ % size, info);
+  }));
+  key = size;
+  Print("LRU_Cache::find", "miss, full cache", Measure([&] () {
+    sink += cache.find(key++, info);
+  }));
+  key = 1ULL << 40;
+  Print("LRU_Cache::insert", "full cache", Measure([&] () {
+    sink += cache.insert(key++, info);
+  }));
+}
+
+int main(int argc, const char* argv[]) {
+  Commandlineparser args("Microbenchmarks of the propagation primitives");
+  args.addParameter("--seconds", "minimum time of every benchmark", "0.2");
+  args.addParameter("-h", "display help", nullptr);
+  args.parse(argc, argv);
+  if (args.getBoolParameter("-h")) {
+    args.print_help();
+    return 0;
+  }
+  min_seconds = args.getFloatParameter("--seconds");
+
+  std::cout << std::left << std::setw(28) << "benchmark" << std::setw(24)
+            << "case" << std::right << std::setw(12) << "ns/op"
+            << std::setw(12) << "allocs/op" << std::endl;
+
+  struct Target {
+    const char* name_;
+    int rounds_;
+  };
+  for (Target target : { Target { "ascon", 3 }, Target { "icepole", 3 },
+      Target { "keccak1600", 2 }, Target { "prost256", 4 } }) {
+    std::unique_ptr<Permutation> perm(
+        permutation_list(target.name_, target.rounds_));
+    std::string name = target.name_;
+    if (name == "ascon")
+      BenchNonlinearStep<5, 64>(name, perm.get());
+    if (name == "prost256")
+      BenchNonlinearStep<4, 128>(name, perm.get());
+    BenchLinearLayer(name, perm.get());
+    BenchStateMask(name, perm.get());
+    BenchVerticalMask(name, perm.get());
+    BenchSaveRestore(name, perm.get());
+  }
+  BenchLruCache();
+  return 0;
+}
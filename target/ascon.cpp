@@ -190,6 +190,14 @@ void AsconLinearLayer::copyValues(LinearLayer* other){
   sigmas = ptr->sigmas;
 }
 
+bool AsconLinearLayer::Transform(const std::vector<BitVector>& x,
+                                 std::vector<BitVector>& y) {
+  y.resize(x.size());
+  for (unsigned int i = 0; i < linear_steps_; ++i)
+    sigmas[i].Apply(&x[i], &y[i]);
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 
 BitVector AsconSbox(BitVector in) {
@@ -201,7 +209,7 @@ BitVector AsconSbox(BitVector in) {
   return sbox[in % 32] & 0x1f;
 }
 
-std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> AsconSboxLayer::cache_;
+thread_local std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> AsconSboxLayer::cache_;
 std::shared_ptr<LinearDistributionTable<5>> AsconSboxLayer::ldt_;
 
 AsconSboxLayer& AsconSboxLayer::operator=(const AsconSboxLayer& rhs) {
@@ -213,10 +221,6 @@ AsconSboxLayer::AsconSboxLayer() {
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<5>(AsconSbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 AsconSboxLayer::AsconSboxLayer(StateMaskBase *in, StateMaskBase *out)
@@ -224,10 +228,6 @@ AsconSboxLayer::AsconSboxLayer(StateMaskBase *in, StateMaskBase *out)
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<5>(AsconSbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 AsconSboxLayer* AsconSboxLayer::clone() {
@@ -263,6 +263,11 @@ bool AsconSboxLayer::updateStep(unsigned int step_pos) {
   bool ret_val;
   Mask copyin(GetVerticalMask(step_pos, *in));
   Mask copyout(GetVerticalMask(step_pos, *out));
+  // the cache is per thread, so it is created by the first update on a thread
+  if (cache_.get() == nullptr)
+    cache_.reset(
+        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
+            cache_size_));
   ret_val = sboxes[step_pos].Update(copyin, copyout, cache_.get());
   SetVerticalMask(step_pos, *in, copyin);
   SetVerticalMask(step_pos, *out, copyout);
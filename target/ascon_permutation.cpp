@@ -74,6 +74,12 @@ Permutation::PermPtr AsconPermutation::clone() const {
   return PermPtr(new AsconPermutation(*this));
 }
 
+unsigned int AsconPermutation::RotationalSymmetry() {
+  // the S-boxes and the rotations of the words commute with rotating all
+  // words by the same amount
+  return 64;
+}
+
 void AsconPermutation::PrintWithProbability(std::ostream& stream,
                                             unsigned int offset) {
   Permutation::PrintWithProbability(stream, 0);
@@ -39,6 +39,7 @@ struct AsconPermutation : public Permutation {
   AsconPermutation(const AsconPermutation& other);
   void touchall();
   PermPtr clone() const;
+  unsigned int RotationalSymmetry();
   virtual void PrintWithProbability(std::ostream& stream = std::cout,
                                     unsigned int offset = 0) override;
 
@@ -196,6 +196,13 @@ void IcepoleLinearLayer::copyValues(LinearLayer* other){
   icepole_linear_ = ptr->icepole_linear_;
 }
 
+bool IcepoleLinearLayer::Transform(const std::vector<BitVector>& x,
+                                   std::vector<BitVector>& y) {
+  y.resize(x.size());
+  icepole_linear_[0].Apply(x.data(), y.data());
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 
 BitVector IcepoleSbox(BitVector in) {
@@ -205,7 +212,7 @@ BitVector IcepoleSbox(BitVector in) {
   return sbox[in % 32] & 0x1f;
 }
 
-std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> IcepoleSboxLayer::cache_;
+thread_local std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> IcepoleSboxLayer::cache_;
 std::shared_ptr<LinearDistributionTable<5>> IcepoleSboxLayer::ldt_;
 
 IcepoleSboxLayer& IcepoleSboxLayer::operator=(const IcepoleSboxLayer& rhs) {
@@ -217,10 +224,6 @@ IcepoleSboxLayer::IcepoleSboxLayer() {
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<5>(IcepoleSbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 IcepoleSboxLayer::IcepoleSboxLayer(StateMaskBase *in, StateMaskBase *out)
@@ -228,10 +231,6 @@ IcepoleSboxLayer::IcepoleSboxLayer(StateMaskBase *in, StateMaskBase *out)
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<5>(IcepoleSbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 IcepoleSboxLayer* IcepoleSboxLayer::clone() {
@@ -246,6 +245,11 @@ bool IcepoleSboxLayer::updateStep(unsigned int step_pos) {
   bool ret_val;
   Mask copyin(GetVerticalMask(step_pos, *in));
   Mask copyout(GetVerticalMask(step_pos, *out));
+  // the cache is per thread, so it is created by the first update on a thread
+  if (cache_.get() == nullptr)
+    cache_.reset(
+        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
+            cache_size_));
   ret_val = sboxes[step_pos].Update(copyin, copyout, cache_.get());
   SetVerticalMask(step_pos, *in, copyin);
   SetVerticalMask(step_pos, *out, copyout);
@@ -183,6 +183,13 @@ void Keccak1600LinearLayer::copyValues(LinearLayer* other){
   keccak_linear_ = ptr->keccak_linear_;
 }
 
+bool Keccak1600LinearLayer::Transform(const std::vector<BitVector>& x,
+                                      std::vector<BitVector>& y) {
+  y.resize(x.size());
+  keccak_linear_[0].Apply(x.data(), y.data());
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 
 BitVector Keccak1600Sbox(BitVector in) {
@@ -192,7 +199,7 @@ BitVector Keccak1600Sbox(BitVector in) {
   return sbox[in % 32] & 0x1f;
 }
 
-std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> Keccak1600SboxLayer::cache_;
+thread_local std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> Keccak1600SboxLayer::cache_;
 std::shared_ptr<LinearDistributionTable<5>> Keccak1600SboxLayer::ldt_;
 
 Keccak1600SboxLayer& Keccak1600SboxLayer::operator=(const Keccak1600SboxLayer& rhs) {
@@ -204,10 +211,6 @@ Keccak1600SboxLayer::Keccak1600SboxLayer() {
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<5>(Keccak1600Sbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 Keccak1600SboxLayer::Keccak1600SboxLayer(StateMaskBase *in, StateMaskBase *out)
@@ -215,10 +218,6 @@ Keccak1600SboxLayer::Keccak1600SboxLayer(StateMaskBase *in, StateMaskBase *out)
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<5>(Keccak1600Sbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 Keccak1600SboxLayer* Keccak1600SboxLayer::clone() {
@@ -233,6 +232,11 @@ bool Keccak1600SboxLayer::updateStep(unsigned int step_pos) {
   bool ret_val;
   Mask copyin(GetVerticalMask(step_pos, *in));
   Mask copyout(GetVerticalMask(step_pos, *out));
+  // the cache is per thread, so it is created by the first update on a thread
+  if (cache_.get() == nullptr)
+    cache_.reset(
+        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
+            cache_size_));
   ret_val = sboxes[step_pos].Update(copyin, copyout, cache_.get());
   SetVerticalMask(step_pos, *in, copyin);
   SetVerticalMask(step_pos, *out, copyout);
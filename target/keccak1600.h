@@ -37,6 +37,7 @@ struct Keccak1600LinearLayer : public LinearLayer {
   virtual bool updateStep(unsigned int step_pos);
   unsigned int GetNumSteps();
   virtual void copyValues(LinearLayer* other);
+  virtual bool Transform(const std::vector<BitVector>& x, std::vector<BitVector>& y);
 
   static const unsigned int word_size_ = { 64 };
   static const unsigned int words_per_step_ = { 25 };
@@ -55,7 +56,7 @@ struct Keccak1600SboxLayer : public SboxLayer<5, 320> {
   void SetVerticalMask(unsigned int b, StateMaskBase& s, const Mask& mask);
 
  static const unsigned int cache_size_ = { 0x1000 };
- static std::unique_ptr<LRU_Cache<unsigned long long,NonlinearStepUpdateInfo>> cache_;
+ static thread_local std::unique_ptr<LRU_Cache<unsigned long long,NonlinearStepUpdateInfo>> cache_;
  static std::shared_ptr<LinearDistributionTable<5>> ldt_;
 };
 
@@ -1,4 +1,6 @@
 #include "keccak1600_permutation.h"
+#include "metrics.h"
+#include "trace.h"
 
 
 Keccak1600Permutation::Keccak1600Permutation(unsigned int rounds) : Permutation(rounds) {
@@ -21,6 +23,7 @@ Keccak1600Permutation::Keccak1600Permutation(unsigned int rounds) : Permutation(
 
 
 Keccak1600Permutation::Keccak1600Permutation(const Keccak1600Permutation& other) : Permutation(other.rounds_) {
+  TRACE_SCOPE("Permutation::clone");
   for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
     this->state_masks_[i].reset(other.state_masks_[i]->clone());
   }
@@ -35,6 +38,10 @@ Keccak1600Permutation::Keccak1600Permutation(const Keccak1600Permutation& other)
   }
   this->toupdate_linear = other.toupdate_linear;
   this->toupdate_nonlinear = other.toupdate_nonlinear;
+  this->canonical_ = other.canonical_;
+  this->statistics_ = other.statistics_;
+  this->decisions_ = other.decisions_;
+  Metrics::Count(METRIC_CLONES);
 
   for(unsigned int i = 0; i< 2*rounds_ +1; ++i){
       this->saved_state_masks_[i].reset(new Keccak1600State);
@@ -83,16 +90,22 @@ Keccak1600Permutation& Keccak1600Permutation::operator=(const Keccak1600Permutat
 
 
 bool Keccak1600Permutation::update() {
+  TRACE_SCOPE("Permutation::update");
   std::unique_ptr<StateMaskBase> tempin, tempout;
   bool update_before, update_after;
+  Metrics::Count(METRIC_PROPAGATIONS);
   while (this->toupdate_linear == true || this->toupdate_nonlinear == true) {
+    Metrics::Count(METRIC_SWEEPS);
     if (this->toupdate_nonlinear == true) {
       this->toupdate_nonlinear = false;
       for (unsigned int layer = 0; layer < rounds_; ++layer) {
+        Metrics::Count(METRIC_SBOX_UPDATES);
         tempin.reset(this->sbox_layers_[layer]->in->clone());
         tempout.reset(this->sbox_layers_[layer]->out->clone());
-        if (this->sbox_layers_[layer]->Update() == false)
+        if (this->sbox_layers_[layer]->Update() == false) {
+          Metrics::Contradiction(layer, false);
           return false;
+        }
         update_before = this->sbox_layers_[layer]->in->diffLinear(*(tempin));
         update_after = this->sbox_layers_[layer]->out->diffLinear(*(tempout));
 //        update_before = this->sbox_layers_[layer]->in->changesforLinear();
@@ -104,10 +117,13 @@ bool Keccak1600Permutation::update() {
     if (this->toupdate_linear == true) {
       this->toupdate_linear = false;
       for (unsigned int layer = 0; layer < rounds_; ++layer) {
+        Metrics::Count(METRIC_LINEAR_UPDATES);
         tempin.reset(this->linear_layers_[layer]->in->clone());
         tempout.reset(this->linear_layers_[layer]->out->clone());
-        if (this->linear_layers_[layer]->Update() == false)
+        if (this->linear_layers_[layer]->Update() == false) {
+          Metrics::Contradiction(layer, true);
           return false;
+        }
         update_before = this->linear_layers_[layer]->in->diffSbox(*(tempin));
         update_after = this->linear_layers_[layer]->out->diffSbox(*(tempout));
 //        update_before = this->sbox_layers_[layer]->in->changesforSbox();
@@ -125,6 +141,12 @@ Permutation::PermPtr Keccak1600Permutation::clone() const {
   return PermPtr(new Keccak1600Permutation(*this));
 }
 
+unsigned int Keccak1600Permutation::RotationalSymmetry() {
+  // theta, rho, pi and chi commute with rotating all lanes by the same
+  // amount, the round constants do not change linear masks
+  return 64;
+}
+
 
 void Keccak1600Permutation::PrintWithProbability(std::ostream& stream,
                                                  unsigned int offset) {
@@ -17,6 +17,7 @@ struct Keccak1600Permutation : public Permutation {
   bool update();
   void touchall();
   PermPtr clone() const;
+  unsigned int RotationalSymmetry();
   virtual void PrintWithProbability(std::ostream& stream = std::cout,
                                     unsigned int offset = 0) override;
 
@@ -83,7 +83,7 @@ BitVector Prost256Sbox(BitVector in) {
   return sbox[in % 16] & 0xf;
 }
 
-std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> Prost256SboxLayer::cache_;
+thread_local std::unique_ptr<LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>> Prost256SboxLayer::cache_;
 std::shared_ptr<LinearDistributionTable<4>> Prost256SboxLayer::ldt_;
 
 Prost256SboxLayer& Prost256SboxLayer::operator=(const Prost256SboxLayer& rhs) {
@@ -95,10 +95,6 @@ Prost256SboxLayer::Prost256SboxLayer() {
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<4>(Prost256Sbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 Prost256SboxLayer::Prost256SboxLayer(StateMaskBase *in, StateMaskBase *out)
@@ -106,10 +102,6 @@ Prost256SboxLayer::Prost256SboxLayer(StateMaskBase *in, StateMaskBase *out)
   if(ldt_ == nullptr)
     ldt_.reset(new LinearDistributionTable<4>(Prost256Sbox));
   InitSboxes(ldt_);
-  if (this->cache_.get() == nullptr)
-    this->cache_.reset(
-        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
-            cache_size_));
 }
 
 Prost256SboxLayer* Prost256SboxLayer::clone() {
@@ -124,6 +116,11 @@ bool Prost256SboxLayer::updateStep(unsigned int step_pos) {
   bool ret_val;
   Mask copyin(GetVerticalMask(step_pos, *in));
   Mask copyout(GetVerticalMask(step_pos, *out));
+  // the cache is per thread, so it is created by the first update on a thread
+  if (cache_.get() == nullptr)
+    cache_.reset(
+        new LRU_Cache<unsigned long long, NonlinearStepUpdateInfo>(
+            cache_size_));
   ret_val = sboxes[step_pos].Update(copyin, copyout, cache_.get());
   SetVerticalMask(step_pos, *in, copyin);
   SetVerticalMask(step_pos, *out, copyout);
@@ -36,7 +36,7 @@ struct Prost256SboxLayer : public SboxLayer<4, 128> {
   void SetVerticalMask(unsigned int b, StateMaskBase& s, const Mask& mask);
 
  static const unsigned int cache_size_ = { 0x1000 };
- static std::unique_ptr<LRU_Cache<unsigned long long,NonlinearStepUpdateInfo>> cache_;
+ static thread_local std::unique_ptr<LRU_Cache<unsigned long long,NonlinearStepUpdateInfo>> cache_;
  static std::shared_ptr<LinearDistributionTable<4>> ldt_;
 };
 
@@ -50,6 +50,7 @@ struct Prost256LinearLayer : public LinearLayer {
   virtual bool updateStep(unsigned int step_pos);
   unsigned int GetNumSteps();
   virtual void copyValues(LinearLayer* other);
+  virtual bool Transform(const std::vector<BitVector>& x, std::vector<BitVector>& y);
 
   static const unsigned int word_size_ = { 32 };
   static const unsigned int words_per_step_ = { 16 };
@@ -209,6 +210,14 @@ void Prost256LinearLayer<parity>::copyValues(LinearLayer* other){
   prost256_linear_ = ptr->prost256_linear_;
 }
 
+template <unsigned parity>
+bool Prost256LinearLayer<parity>::Transform(const std::vector<BitVector>& x,
+                                            std::vector<BitVector>& y) {
+  y.resize(x.size());
+  prost256_linear_[0].Apply(x.data(), y.data());
+  return true;
+}
+
 
 
 #endif // PROST256_H_
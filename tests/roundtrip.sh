@@ -0,0 +1,120 @@
+#!/bin/sh
+# writes what a search can read back, a checkpoint, a guess trace, a trail
+# database and the jsonl and binary records, reads it again with a fixed seed
+# on the 2 round Ascon search file and compares it with the original run
+#
+#   sh tests/roundtrip.sh [binary]
+
+lin=${1:-./lin}
+dir=$(dirname "$0")
+esc=$(printf '\033')
+search="$dir/ascon_2_rounds.xml"
+tmp=$(mktemp -d)
+failed=0
+
+run() {
+  out=$1
+  shift
+  "$lin" "$@" -i "$search" -I 0 2>&1 \
+      | sed -e "s/$esc\[[0-9;]*m//g" \
+      | grep -v "seconds" > "$tmp/$out"
+}
+
+check() {
+  if [ "$2" = "$3" ] && [ -n "$2" ]; then
+    echo "$1: ok"
+  else
+    echo "$1: FAILED, '$2' instead of '$3'"
+    failed=1
+  fi
+}
+
+# a counter of a --metrics export
+counter() {
+  sed -e "s/.*\"$2\":\([0-9]*\).*/\1/" "$tmp/$1"
+}
+
+# the characteristics of a search output without its messages
+characteristics() {
+  grep -v "PRINT-INFO\|Seed" "$tmp/$1"
+}
+
+# the metrics count every guess the trace records and every reported
+# characteristic
+run record -u search -iter 20 --seed 7 --record "$tmp/trace" \
+    --metrics "$tmp/record.json" --trail-db "$tmp/trails"
+check metrics "$(counter record.json guesses)" \
+    "$(sed -n 's/.*recorded \([0-9]*\) guesses.*/\1/p' "$tmp/record")"
+check characteristics "$(counter record.json characteristics)" \
+    "$(grep -c "^iteration:" "$tmp/record")"
+
+# a replay with another seed takes every decision from the trace
+run replay -u search -iter 20 --seed 8 --replay "$tmp/trace"
+check replay "$(grep -c "none diverged" "$tmp/replay")" 1
+characteristics record > "$tmp/record.chars"
+characteristics replay > "$tmp/replay.chars"
+if cmp -s "$tmp/record.chars" "$tmp/replay.chars"; then
+  echo "replay output: ok"
+else
+  echo "replay output: FAILED"
+  diff "$tmp/record.chars" "$tmp/replay.chars" | head -20
+  failed=1
+fi
+
+# every stored characteristic starts a restart again
+run seeded -u search -iter 1 --seed 7 --seed-from "$tmp/trails"
+check trail-db "$(grep -c "2 of 2 stored characteristics fit" "$tmp/seeded")" 1
+
+# a stopped and resumed search makes the guesses of one which ran through
+run full -u search -iter 100 --seed 7 --metrics "$tmp/full.json"
+run stopped -u search -iter 100 --seed 7 --guess-budget 3000 \
+    --checkpoint "$tmp/checkpoint" --metrics "$tmp/stopped.json"
+run resumed -u search -iter 100 --seed 7 --resume "$tmp/checkpoint" \
+    --metrics "$tmp/resumed.json"
+check checkpoint \
+    "$(( $(counter stopped.json guesses) + $(counter resumed.json guesses) ))" \
+    "$(counter full.json guesses)"
+check "checkpoint restarts" "$(grep -c "resumed in restart" "$tmp/resumed")" 1
+
+# the binary records hold the bias, the active S-boxes and the masks of the
+# jsonl records
+run jsonl -u search -iter 20 --seed 7 --format jsonl \
+    --output "$tmp/trails.jsonl"
+run binary -u search -iter 20 --seed 7 --format binary \
+    --output "$tmp/trails.bin"
+first=$(head -n 1 "$tmp/trails.jsonl")
+label=$(od -An -t u4 -j 4 -N 4 "$tmp/trails.bin" | tr -d ' ')
+check "jsonl records" "$(wc -l < "$tmp/trails.jsonl" | tr -d ' ')" \
+    "$(grep -c "^iteration:" "$tmp/record")"
+check "binary bias" \
+    "$(od -An -t f8 -j $((12 + label)) -N 8 "$tmp/trails.bin" | tr -d ' ')" \
+    "$(echo "$first" | sed -e 's/.*"bias":\([^,]*\),.*/\1/')"
+check "binary active" \
+    "$(od -An -t u4 -j $((20 + label)) -N 4 "$tmp/trails.bin" | tr -d ' ')" \
+    "$(echo "$first" | sed -e 's/.*"active":\([0-9]*\),.*/\1/')"
+# 2 rounds have 5 states of 5 words, the first plane follows their sizes
+check "binary masks" \
+    "$(od -An -t x8 -j $((52 + label)) -N 8 "$tmp/trails.bin" | tr -d ' ')" \
+    "$(echo "$first" | sed -e 's/.*"masks":\["\(.\{16\}\).*/\1/')"
+
+# the result of a search file does not depend on the workers of batch
+mkdir "$tmp/batch"
+cp "$search" "$tmp/batch/first.xml"
+cp "$search" "$tmp/batch/second.xml"
+"$lin" -u batch --batch "$tmp/batch" --batch-out "$tmp/one" -iter 5 \
+    --seed 7 -I 0 --threads 1 > /dev/null 2>&1
+"$lin" -u batch --batch "$tmp/batch" --batch-out "$tmp/two" -iter 5 \
+    --seed 7 -I 0 --threads 2 > /dev/null 2>&1
+for job in first second; do
+  grep -v "seconds" "$tmp/one/$job.out" > "$tmp/one.out"
+  grep -v "seconds" "$tmp/two/$job.out" > "$tmp/two.out"
+  if [ -s "$tmp/one.out" ] && cmp -s "$tmp/one.out" "$tmp/two.out"; then
+    echo "batch $job: ok"
+  else
+    echo "batch $job: FAILED"
+    failed=1
+  fi
+done
+
+rm -rf "$tmp"
+exit $failed
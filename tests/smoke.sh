@@ -0,0 +1,44 @@
+#!/bin/sh
+# runs every mode once with a fixed seed on a 2 round Ascon search file and
+# compares the output with tests/expected, times and colors are left out
+#
+#   sh tests/smoke.sh [binary] [update]
+#
+# update writes the current output to tests/expected instead
+
+lin=${1:-./lin}
+update=$2
+dir=$(dirname "$0")
+esc=$(printf '\033')
+search="$dir/ascon_2_rounds.xml"
+char="$dir/ascon_2_rounds_char.xml"
+failed=0
+
+run() {
+  name=$1
+  shift
+  "$lin" "$@" --seed 7 -I 0 2>&1 \
+      | sed -e "s/$esc\[[0-9;]*m//g" \
+      | grep -v "seconds" > "$dir/$name.out"
+  if [ "$update" = "update" ]; then
+    mv "$dir/$name.out" "$dir/expected/$name.out"
+  elif cmp -s "$dir/$name.out" "$dir/expected/$name.out"; then
+    echo "$name: ok"
+    rm -f "$dir/$name.out"
+  else
+    echo "$name: FAILED"
+    diff "$dir/expected/$name.out" "$dir/$name.out" | head -20
+    failed=1
+  fi
+}
+
+run checkchar -u checkchar -i "$char"
+run search    -u search    -i "$search" -iter 3
+run beam      -u beam      -i "$search" -iter 1
+run twostage  -u twostage  -i "$search" -iter 5
+run tune      -u tune      -i "$search" -iter 6 --arms 3
+run hull      -u hull      -i "$char"
+run middle    -u middle    -i "$search" -iter 3
+run extend    -u extend    -i "$search" --extend-restarts 2
+run minactive -u minactive -i "$search"
+exit $failed
@@ -0,0 +1,168 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "batch.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "random.h"
+#include "search.h"
+#include "trace.h"
+
+Batch::Batch(Commandlineparser& cl_param)
+    : cl_param_(cl_param),
+      directory_(cl_param.getParameter("--batch-out")),
+      next_(0) {
+  // the files of a single search would be written by every job at once
+  cl_param_.setParameter("--output", "-");
+  cl_param_.setParameter("--checkpoint", "");
+  cl_param_.setParameter("--resume", "");
+  cl_param_.setParameter("--record", "");
+  cl_param_.setParameter("--replay", "");
+  cl_param_.setParameter("--trail-db", "");
+}
+
+void Batch::Run(std::ostream& stream) {
+  std::vector<std::string> configs = Configs(cl_param_.getParameter("--batch"));
+  if (configs.empty()) {
+    stream << "No search files in " << cl_param_.getParameter("--batch")
+           << std::endl;
+    return;
+  }
+  mkdir(directory_.c_str(), 0755);
+
+  // the permutations are built here, before the workers share them
+  std::set<std::string> outputs;
+  for (const std::string& config : configs) {
+    std::unique_ptr<Configparser> parser(new Configparser());
+    if (parser->parseFile(config, false, true) == false) {
+      stream << "BATCH: " << config << " failed to load" << std::endl;
+      continue;
+    }
+    std::string name = config.substr(config.find_last_of('/') + 1);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".xml") == 0)
+      name.resize(name.size() - 4);
+    std::string output = name;
+    for (int i = 2; outputs.insert(output).second == false; ++i)
+      output = name + "-" + std::to_string(i);
+    jobs_.push_back(BatchJob { config, directory_ + "/" + output + ".out",
+                               std::move(parser) });
+  }
+
+  unsigned int threads = std::max(1, cl_param_.getIntParameter("--threads"));
+  // the guesses are counted for the whole process, so the jobs running at
+  // the same time would use up each other's budget
+  if (threads > 1 && cl_param_.getIntParameter("--guess-budget") > 0) {
+    stream << "BATCH: --guess-budget needs --threads 1, it is ignored"
+           << std::endl;
+    cl_param_.setParameter("--guess-budget", "0");
+  }
+  stream << "BATCH: " << jobs_.size() << " search files on " << threads
+         << " threads, output in " << directory_ << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < threads; ++i)
+    workers.emplace_back(&Batch::Work, this, i + 1, std::ref(stream));
+  for (auto& worker : workers)
+    worker.join();
+  stream << "BATCH: done in " << std::fixed << std::setprecision(2)
+         << std::chrono::duration<double>(
+             std::chrono::steady_clock::now() - start).count()
+         << " s" << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+void Batch::Work(unsigned int worker, std::ostream& stream) {
+  Random::UseThread(worker);
+  for (size_t i = next_++; i < jobs_.size(); i = next_++)
+    RunJob(i, stream);
+}
+
+void Batch::RunJob(size_t index, std::ostream& stream) {
+  BatchJob& job = jobs_[index];
+  std::ofstream output(job.output_);
+  if (output.is_open() == false) {
+    std::lock_guard<std::mutex> lock(print_mutex_);
+    stream << "BATCH: cannot write " << job.output_ << std::endl;
+    return;
+  }
+  // the result of a job does not depend on the worker it runs on
+  Random::UseStream(index);
+  auto start = std::chrono::steady_clock::now();
+  output << "Configfile: " << job.config_ << std::endl;
+  output << "Iterations: " << cl_param_.getIntParameter("-iter") << std::endl;
+  // the search files were all parsed before, so the trace is told again
+  // which permutation this worker searches
+  TRACE_TARGET(job.parser_->getPermutationName());
+  std::unique_ptr<Permutation> perm = job.parser_->getPermutation();
+  Search search(*perm);
+  search.setOutput(output);
+  if (job.parser_->getPermutationName().compare(0, 6, "keccak") == 0)
+    search.StackSearchKeccak(cl_param_, *job.parser_);
+  else
+    search.StackSearch1(cl_param_, *job.parser_);
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(print_mutex_);
+  stream << "BATCH: " << job.config_ << " " << std::fixed
+         << std::setprecision(2) << seconds << " s, best bias ";
+  if (search.getBestBias() == -DBL_MAX)
+    stream << "-";
+  else
+    stream << std::setprecision(0) << search.getBestBias();
+  stream << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+// the search files of a directory, or the ones listed in a file, one per line
+std::vector<std::string> Batch::Configs(const std::string& list) {
+  std::vector<std::string> configs;
+  DIR* dir = opendir(list.c_str());
+  if (dir != nullptr) {
+    while (dirent* entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".xml") == 0)
+        configs.push_back(list + "/" + name);
+    }
+    closedir(dir);
+    std::sort(configs.begin(), configs.end());
+    return configs;
+  }
+  std::ifstream file(list);
+  std::string line;
+  while (std::getline(file, line))
+    if (line.empty() == false && line[0] != '#')
+      configs.push_back(line);
+  return configs;
+}
@@ -0,0 +1,66 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "commandlineparser.h"
+#include "configparser.h"
+
+struct BatchJob {
+  std::string config_;
+  std::string output_;  // the file the search of the job prints to
+  std::unique_ptr<Configparser> parser_;
+};
+
+// runs search (keccak for the Keccak permutations) on a list of search files
+// with --threads workers in one process, the S-box tables and linear steps
+// are built once and the caches of a worker stay warm from one search file
+// to the next, every search file prints to its own file
+struct Batch {
+  Batch(Commandlineparser& cl_param);
+  void Run(std::ostream& stream);
+
+ private:
+  void Work(unsigned int worker, std::ostream& stream);
+  void RunJob(size_t index, std::ostream& stream);
+  static std::vector<std::string> Configs(const std::string& list);
+
+  Commandlineparser cl_param_;
+  std::string directory_;
+  std::vector<BatchJob> jobs_;
+  std::atomic<size_t> next_;
+  std::mutex print_mutex_;
+};
+
+#endif /* BATCH_H_ */
@@ -0,0 +1,159 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include "configparser.h"
+#include "metrics.h"
+#include "random.h"
+#include "search.h"
+
+Benchmark::Benchmark(Commandlineparser& cl_param)
+    : cl_param_(cl_param),
+      seed_(std::strtoull(cl_param.getParameter("--seed"), nullptr, 10)) {
+  // without a seed or a guess budget, the benchmark still repeats itself
+  if (seed_ == 0)
+    seed_ = 1;
+  if (std::strtoull(cl_param.getParameter("--guess-budget"), nullptr, 10) == 0)
+    cl_param_.setParameter("--guess-budget", "1000");
+  cl_param_.setParameter("-I", "-1");
+}
+
+void Benchmark::Run(std::ostream& stream) {
+  std::string directory = cl_param_.getParameter("--bench-dir");
+  std::vector<std::string> configs = Configs(directory);
+  stream << "BENCH: seed " << seed_ << ", "
+         << cl_param_.getParameter("--guess-budget")
+         << " guesses per search file in " << directory << std::endl;
+  stream << std::left << std::setw(34) << "search file" << std::right
+         << std::setw(10) << "guesses" << std::setw(10) << "seconds"
+         << std::setw(12) << "guesses/s" << std::setw(12) << "props/s"
+         << std::setw(12) << "cum. RSS MB" << std::setw(11) << "best bias"
+         << std::endl;
+
+  uint64_t guesses = 0, propagations = 0;
+  double seconds = 0;
+  for (const std::string& config : configs) {
+    BenchmarkResult result = RunConfig(directory, config);
+    stream << std::left << std::setw(34) << result.config_ << std::right;
+    if (result.ok_ == false) {
+      stream << "  failed to load" << std::endl;
+      continue;
+    }
+    guesses += result.guesses_;
+    propagations += result.propagations_;
+    seconds += result.seconds_;
+    stream << std::setw(10) << result.guesses_ << std::setw(10)
+           << std::fixed << std::setprecision(2) << result.seconds_
+           << std::setw(12) << std::setprecision(0)
+           << result.guesses_ / result.seconds_ << std::setw(12)
+           << result.propagations_ / result.seconds_ << std::setw(12)
+           << std::setprecision(1) << result.peak_rss_kb_ / 1024.0;
+    if (result.best_bias_ == -DBL_MAX)
+      stream << std::setw(11) << "-";
+    else
+      stream << std::setw(11) << std::setprecision(0) << result.best_bias_;
+    stream << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+  if (seconds > 0)
+    stream << std::left << std::setw(34) << "total" << std::right
+           << std::setw(10) << guesses << std::setw(10) << std::fixed
+           << std::setprecision(2) << seconds << std::setw(12)
+           << std::setprecision(0) << guesses / seconds << std::setw(12)
+           << propagations / seconds << std::setw(12) << std::setprecision(1)
+           << PeakRss() / 1024.0 << std::defaultfloat << std::setprecision(6)
+           << std::endl;
+  stream << "BENCH: cum. RSS is the peak memory of the whole process up to "
+         << "the search file" << std::endl;
+}
+
+BenchmarkResult Benchmark::RunConfig(const std::string& directory,
+                                     const std::string& config) {
+  BenchmarkResult result { config, false, 0, 0, 0, 0, -DBL_MAX };
+  Configparser parser;
+  if (parser.parseFile(directory + "/" + config, false) == false)
+    return result;
+  result.ok_ = true;
+
+  Random::Seed(seed_);
+  MetricsSnapshot before = Metrics::Read();
+  auto start = std::chrono::steady_clock::now();
+
+  // the output of the search is not part of the benchmark, a stream without
+  // a buffer drops it
+  std::ostream discard(nullptr);
+  Search search(*parser.getPermutation());
+  search.setOutput(discard);
+  if (parser.getPermutationName().compare(0, 6, "keccak") == 0)
+    search.StackSearchKeccak(cl_param_, parser);
+  else
+    search.StackSearch1(cl_param_, parser);
+
+  MetricsSnapshot after = Metrics::Read();
+  result.seconds_ = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  result.guesses_ = after.counters_[METRIC_GUESSES]
+      - before.counters_[METRIC_GUESSES];
+  result.propagations_ = after.counters_[METRIC_PROPAGATIONS]
+      - before.counters_[METRIC_PROPAGATIONS];
+  result.peak_rss_kb_ = PeakRss();
+  result.best_bias_ = search.getBestBias();
+  return result;
+}
+
+std::vector<std::string> Benchmark::Configs(const std::string& directory) {
+  std::vector<std::string> configs;
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr)
+    return configs;
+  while (dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".xml") == 0)
+      configs.push_back(name);
+  }
+  closedir(dir);
+  std::sort(configs.begin(), configs.end());
+  return configs;
+}
+
+// the peak of the whole process so far, it only grows from one search file
+// to the next
+long Benchmark::PeakRss() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
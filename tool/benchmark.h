@@ -0,0 +1,65 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "commandlineparser.h"
+
+struct BenchmarkResult {
+  std::string config_;
+  bool ok_;
+  uint64_t guesses_;
+  uint64_t propagations_;
+  double seconds_;
+  long peak_rss_kb_;
+  double best_bias_;
+};
+
+// runs search (keccak for the Keccak permutations) on every search file of a
+// directory with the same seed and number of guesses, so that the numbers of
+// two builds or machines can be compared
+struct Benchmark {
+  Benchmark(Commandlineparser& cl_param);
+  void Run(std::ostream& stream);
+
+ private:
+  BenchmarkResult RunConfig(const std::string& directory,
+                            const std::string& config);
+  static std::vector<std::string> Configs(const std::string& directory);
+  static long PeakRss();
+
+  Commandlineparser& cl_param_;
+  uint64_t seed_;
+};
+
+#endif /* BENCHMARK_H_ */
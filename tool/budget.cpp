@@ -0,0 +1,142 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "budget.h"
+
+#include <cfloat>
+#include <cstdlib>
+
+#include "metrics.h"
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+static void RequestStop(int signal) {
+  stop_requested = 1;
+}
+
+void InstallStopHandlers() {
+  std::signal(SIGINT, RequestStop);
+  std::signal(SIGTERM, RequestStop);
+}
+
+//-----------------------------------------------------------------------------
+
+SearchBudget::SearchBudget(Commandlineparser& cl_param)
+    : start_(std::chrono::steady_clock::now()),
+      seconds_(cl_param.getFloatParameter("--time-budget")),
+      guesses_(std::strtoull(cl_param.getParameter("--guess-budget"), nullptr, 10)),
+      start_guesses_(Metrics::Read().counters_[METRIC_GUESSES]),
+      has_target_(cl_param.getFloatParameter("--target-bias") != 0),
+      target_(cl_param.getFloatParameter("--target-bias")),
+      best_(-DBL_MAX) {
+  finished_ = false;
+  // a limited run is stopped cleanly, so that the best result is reported
+  if (seconds_ > 0 || guesses_ > 0 || has_target_)
+    InstallStopHandlers();
+}
+
+bool SearchBudget::Terminate() {
+  // called before every guess, so without a lock, the target bias is
+  // checked by Found
+  static thread_local unsigned int calls = 0;
+  if (finished_.load(std::memory_order_relaxed))
+    return true;
+  if (stop_requested)
+    Finish("stopped by signal");
+  else if (++calls % kCheckInterval)
+    return false;
+  else if (seconds_ > 0 && Elapsed() >= seconds_)
+    Finish("time budget expired");
+  else if (guesses_ > 0 && Metrics::Read().counters_[METRIC_GUESSES]
+      - start_guesses_ >= guesses_)
+    Finish("guess budget used up");
+  return finished_.load(std::memory_order_relaxed);
+}
+
+void SearchBudget::Found(double bias, Permutation* perm) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (bias <= best_)
+    return;
+  best_ = bias;
+  best_perm_ = perm->clone();
+  if (has_target_ && best_ >= target_ && reason_.empty()) {
+    reason_ = "target bias reached";
+    finished_ = true;
+  }
+}
+
+void SearchBudget::Finish(const char* reason) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (reason_.empty())
+    reason_ = reason;
+  finished_ = true;
+}
+
+unsigned int SearchBudget::Phase(const std::vector<float>& shares,
+                                 unsigned int restart,
+                                 unsigned int iterations) {
+  // the phases split the time budget or, without one, the restarts
+  // according to their shares
+  double total = 0;
+  for (float share : shares)
+    total += share;
+  double progress;
+  if (seconds_ > 0)
+    progress = Elapsed() / seconds_;
+  else if (iterations != (unsigned int) -1)
+    progress = (double) restart / iterations;
+  else
+    return 0;
+
+  double bound = 0;
+  for (unsigned int phase = 0; phase < shares.size(); ++phase) {
+    bound += shares[phase] / total;
+    if (progress < bound)
+      return phase;
+  }
+  return shares.empty() ? 0 : shares.size() - 1;
+}
+
+void SearchBudget::Report(std::ostream& stream) {
+  if (reason_.empty() && seconds_ <= 0 && guesses_ == 0
+      && has_target_ == false)
+    return;
+  stream << "PRINT-INFO: search finished";
+  if (reason_.empty() == false)
+    stream << ", " << reason_;
+  stream << " after " << Elapsed() << " seconds" << std::endl;
+  if (best_perm_.get() == nullptr) {
+    stream << "No characteristic found" << std::endl;
+    return;
+  }
+  stream << "Best characteristic:" << std::endl;
+  best_perm_->PrintWithProbability(stream);
+}
+
+double SearchBudget::Elapsed() const {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start_).count();
+}
@@ -0,0 +1,79 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <csignal>
+
+#include "permutation.h"
+#include "commandlineparser.h"
+
+// set by SIGINT and SIGTERM once the handlers are installed, the searches
+// stop at the next guess
+extern volatile std::sig_atomic_t stop_requested;
+void InstallStopHandlers();
+
+// decides when a search stops, either after the wall clock budget, once a
+// characteristic reaches the target bias or after SIGINT and SIGTERM
+struct SearchBudget {
+  SearchBudget(Commandlineparser& cl_param);
+  bool Terminate();
+  void Found(double bias, Permutation* perm);
+  unsigned int Phase(const std::vector<float>& shares, unsigned int restart,
+                     unsigned int iterations);
+  void Report(std::ostream& stream);
+
+ private:
+  // the clock and the guess counter are only read every kCheckInterval calls
+  // of Terminate in a thread
+  static const unsigned int kCheckInterval = 64;
+
+  double Elapsed() const;
+  void Finish(const char* reason);
+
+  std::atomic<bool> finished_;
+  std::mutex mutex_;
+  std::chrono::steady_clock::time_point start_;
+  double seconds_;
+  uint64_t guesses_;        // guesses after which the search stops, 0 for none
+  uint64_t start_guesses_;
+  bool has_target_;
+  double target_;
+  double best_;
+  std::unique_ptr<Permutation> best_perm_;
+  std::string reason_;
+};
+
+#endif /* BUDGET_H_ */
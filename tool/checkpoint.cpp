@@ -0,0 +1,394 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#define CHECKPOINT_MAGIC   0x3350434c  // "LCP3"
+
+namespace {
+
+template <typename T>
+void Put(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void PutString(std::string& out, const std::string& value) {
+  Put<uint32_t>(out, value.size());
+  out += value;
+}
+
+struct Reader {
+  Reader(const std::string& data)
+      : data_(data),
+        pos_(0),
+        ok_(true) {
+  }
+
+  template <typename T>
+  T Get() {
+    T value = T();
+    if (pos_ + sizeof(T) > data_.size()) {
+      ok_ = false;
+      return value;
+    }
+    std::memcpy(&value, data_.data() + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+
+  std::string GetString() {
+    uint32_t size = Get<uint32_t>();
+    if (ok_ == false || pos_ + size > data_.size()) {
+      ok_ = false;
+      return "";
+    }
+    pos_ += size;
+    return data_.substr(pos_ - size, size);
+  }
+
+  const std::string& data_;
+  size_t pos_;
+  bool ok_;
+};
+
+// the words of the planes which differ from the previous ones
+void PutPlanes(std::string& out, const MaskPlanes& planes,
+               const MaskPlanes& previous) {
+  std::vector<uint32_t> changed;
+  for (uint32_t i = 0; i < planes.size(); ++i)
+    if (previous.size() != planes.size() || planes[i] != previous[i])
+      changed.push_back(i);
+  Put<uint32_t>(out, changed.size());
+  for (uint32_t i : changed) {
+    Put<uint32_t>(out, i);
+    Put<uint64_t>(out, planes[i].first);
+    Put<uint64_t>(out, planes[i].second);
+  }
+}
+
+bool GetPermutation(Reader& in, Permutation* prototype, MaskPlanes& planes,
+                    std::unique_ptr<Permutation>& result) {
+  uint32_t changed = in.Get<uint32_t>();
+  for (uint32_t c = 0; c < changed && in.ok_; ++c) {
+    uint32_t i = in.Get<uint32_t>();
+    BitVector canbe1 = in.Get<uint64_t>();
+    BitVector care = in.Get<uint64_t>();
+    if (i >= planes.size())
+      return false;
+    planes[i] = std::make_pair(canbe1, care);
+  }
+  if (in.ok_ == false)
+    return false;
+
+  // the masks are set on a fresh copy, the propagation restores the rest
+  result = prototype->clone();
+  return result->SetPlanes(planes);
+}
+
+// the guesses of learn_weight which led to a characteristic, the first ones
+// it shares with the previous characteristic are only counted
+void PutDecisions(std::string& out, Permutation* perm,
+                  std::vector<const GuessDecision*>& previous) {
+  std::vector<const GuessDecision*> decisions;
+  for (const GuessDecision* decision = perm->decisions_.get();
+      decision != nullptr; decision = decision->previous_.get())
+    decisions.push_back(decision);
+  std::reverse(decisions.begin(), decisions.end());
+  uint32_t shared = 0;
+  while (shared < decisions.size() && shared < previous.size()
+      && decisions[shared] == previous[shared])
+    ++shared;
+  Put<uint32_t>(out, shared);
+  Put<uint32_t>(out, decisions.size() - shared);
+  for (uint32_t i = shared; i < decisions.size(); ++i) {
+    Put<uint32_t>(out, decisions[i]->layer_);
+    Put<uint64_t>(out, decisions[i]->pattern_);
+    Put<uint32_t>(out, decisions[i]->in_);
+    Put<uint32_t>(out, decisions[i]->out_);
+  }
+  previous.swap(decisions);
+}
+
+bool GetDecisions(Reader& in, Permutation* perm,
+                  std::vector<std::shared_ptr<const GuessDecision>>& previous) {
+  uint32_t shared = in.Get<uint32_t>();
+  uint32_t added = in.Get<uint32_t>();
+  if (shared > previous.size())
+    return false;
+  previous.resize(shared);
+  for (uint32_t i = 0; i < added && in.ok_; ++i) {
+    GuessDecision decision;
+    decision.layer_ = in.Get<uint32_t>();
+    decision.pattern_ = in.Get<uint64_t>();
+    decision.in_ = in.Get<uint32_t>();
+    decision.out_ = in.Get<uint32_t>();
+    if (previous.empty() == false)
+      decision.previous_ = previous.back();
+    previous.push_back(std::make_shared<const GuessDecision>(decision));
+  }
+  if (previous.empty() == false)
+    perm->decisions_ = previous.back();
+  return in.ok_;
+}
+
+void PutCharacteristics(std::string& out,
+                        const std::vector<std::unique_ptr<Permutation>>& perms) {
+  MaskPlanes previous, planes;
+  std::vector<const GuessDecision*> decisions;
+  Put<uint32_t>(out, perms.size());
+  for (const auto& perm : perms) {
+    perm->GetPlanes(planes);
+    PutPlanes(out, planes, previous);
+    previous.swap(planes);
+    PutDecisions(out, perm.get(), decisions);
+  }
+}
+
+bool GetCharacteristics(Reader& in, Permutation* prototype,
+                        std::vector<std::unique_ptr<Permutation>>& perms) {
+  MaskPlanes planes;
+  std::vector<std::shared_ptr<const GuessDecision>> decisions;
+  prototype->GetPlanes(planes);
+  uint32_t size = in.Get<uint32_t>();
+  perms.clear();
+  for (uint32_t i = 0; i < size && in.ok_; ++i) {
+    perms.emplace_back();
+    if (GetPermutation(in, prototype, planes, perms.back()) == false
+        || GetDecisions(in, perms.back().get(), decisions) == false)
+      return false;
+  }
+  return in.ok_;
+}
+
+// a single characteristic which may be missing
+void PutOptional(std::string& out, const std::unique_ptr<Permutation>& perm) {
+  std::vector<std::unique_ptr<Permutation>> perms;
+  if (perm)
+    perms.push_back(perm->clone());
+  PutCharacteristics(out, perms);
+}
+
+bool GetOptional(Reader& in, Permutation* prototype,
+                 std::unique_ptr<Permutation>& perm) {
+  std::vector<std::unique_ptr<Permutation>> perms;
+  if (GetCharacteristics(in, prototype, perms) == false || perms.size() > 1)
+    return false;
+  if (perms.empty() == false)
+    perm = std::move(perms.front());
+  return true;
+}
+
+}  // namespace
+
+CheckpointState::CheckpointState()
+    : restart_(0),
+      total_iterations_(0),
+      best_prob_(-DBL_MAX),
+      credits_(0),
+      curr_credit_(0),
+      restart_guesses_(0),
+      backtrack_(false),
+      backtrack_box_(0, 0) {
+}
+
+SearchCheckpoint::SearchCheckpoint(const std::string& filename, int interval,
+                                   std::ostream& out)
+    : filename_(filename),
+      out_(out),
+      interval_(interval),
+      last_(std::chrono::steady_clock::now()),
+      has_pending_(false),
+      finished_(false),
+      failed_(false) {
+  if (Enabled())
+    writer_ = std::thread(&SearchCheckpoint::Write, this);
+}
+
+SearchCheckpoint::~SearchCheckpoint() {
+  if (Enabled() == false)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+  }
+  wakeup_.notify_one();
+  writer_.join();
+  ReportFailure();
+}
+
+bool SearchCheckpoint::Enabled() const {
+  return filename_.empty() == false;
+}
+
+bool SearchCheckpoint::Due() const {
+  return Enabled()
+      && std::chrono::steady_clock::now() - last_ >= interval_;
+}
+
+void SearchCheckpoint::Save(const std::string& config, CheckpointState& state,
+                            std::stack<std::unique_ptr<Permutation>>& char_stack) {
+  if (Enabled() == false)
+    return;
+  last_ = std::chrono::steady_clock::now();
+  ReportFailure();
+
+  // the stack is taken apart for the encoding and put back afterwards
+  state.stack_.clear();
+  while (char_stack.empty() == false) {
+    state.stack_.push_back(std::move(char_stack.top()));
+    char_stack.pop();
+  }
+  std::reverse(state.stack_.begin(), state.stack_.end());
+
+  std::string out;
+  Put<uint32_t>(out, CHECKPOINT_MAGIC);
+  PutString(out, config);
+  Put<uint32_t>(out, state.restart_);
+  Put<int32_t>(out, state.total_iterations_);
+  Put<double>(out, state.best_prob_);
+  Put<uint32_t>(out, state.credits_);
+  Put<uint32_t>(out, state.curr_credit_);
+  Put<uint32_t>(out, state.restart_guesses_);
+  Put<uint8_t>(out, state.backtrack_);
+  Put<uint16_t>(out, state.backtrack_box_.layer_);
+  Put<uint16_t>(out, state.backtrack_box_.pos_);
+  PutString(out, state.generator_);
+  PutString(out, state.statistics_);
+  PutString(out, state.restarts_);
+  PutString(out, state.activity_);
+  PutOptional(out, state.best_);
+  PutOptional(out, state.start_);
+  PutOptional(out, state.carried_);
+  Put<uint32_t>(out, state.top_bias_.size());
+  for (double bias : state.top_bias_)
+    Put<double>(out, bias);
+  PutCharacteristics(out, state.top_);
+  PutCharacteristics(out, state.stack_);
+
+  for (auto& perm : state.stack_)
+    char_stack.push(std::move(perm));
+  state.stack_.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.swap(out);
+    has_pending_ = true;
+  }
+  wakeup_.notify_one();
+}
+
+void SearchCheckpoint::Write() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wakeup_.wait(lock, [this] { return has_pending_ || finished_; });
+    if (has_pending_ == false)
+      return;
+    std::string data;
+    data.swap(pending_);
+    has_pending_ = false;
+    lock.unlock();
+
+    // a checkpoint replaces the old one only once it is written completely
+    std::string temporary = filename_ + ".tmp";
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(data.data(), data.size());
+    file.close();
+    bool failed = file.good() == false
+        || std::rename(temporary.c_str(), filename_.c_str()) != 0;
+    lock.lock();
+    failed_ = failed_ || failed;
+  }
+}
+
+void SearchCheckpoint::ReportFailure() {
+  // the output belongs to the search, so the writer only records a failure
+  bool failed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed = failed_;
+    failed_ = false;
+  }
+  if (failed)
+    out_ << "Writing the checkpoint " << filename_ << " failed" << std::endl;
+}
+
+bool SearchCheckpoint::Load(const std::string& filename,
+                            const std::string& config, Permutation* prototype,
+                            CheckpointState& state, std::ostream& out) {
+  std::ifstream file(filename, std::ios::binary);
+  if (file.is_open() == false) {
+    out << "Cannot open the checkpoint " << filename << std::endl;
+    return false;
+  }
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  Reader in(data);
+  if (in.Get<uint32_t>() != CHECKPOINT_MAGIC) {
+    out << filename << " is no checkpoint" << std::endl;
+    return false;
+  }
+  std::string header = in.GetString();
+  if (header != config) {
+    out << "The checkpoint " << filename << " belongs to " << header
+        << std::endl;
+    return false;
+  }
+  state.restart_ = in.Get<uint32_t>();
+  state.total_iterations_ = in.Get<int32_t>();
+  state.best_prob_ = in.Get<double>();
+  state.credits_ = in.Get<uint32_t>();
+  state.curr_credit_ = in.Get<uint32_t>();
+  state.restart_guesses_ = in.Get<uint32_t>();
+  state.backtrack_ = in.Get<uint8_t>();
+  state.backtrack_box_.layer_ = in.Get<uint16_t>();
+  state.backtrack_box_.pos_ = in.Get<uint16_t>();
+  state.generator_ = in.GetString();
+  state.statistics_ = in.GetString();
+  state.restarts_ = in.GetString();
+  state.activity_ = in.GetString();
+  bool ok = GetOptional(in, prototype, state.best_)
+      && GetOptional(in, prototype, state.start_)
+      && GetOptional(in, prototype, state.carried_);
+  uint32_t top = in.Get<uint32_t>();
+  state.top_bias_.clear();
+  for (uint32_t i = 0; i < top && in.ok_; ++i)
+    state.top_bias_.push_back(in.Get<double>());
+  ok = ok && GetCharacteristics(in, prototype, state.top_)
+      && state.top_.size() == state.top_bias_.size()
+      && GetCharacteristics(in, prototype, state.stack_);
+  if (ok == false || in.ok_ == false) {
+    out << "The checkpoint " << filename << " is damaged" << std::endl;
+    return false;
+  }
+  return true;
+}
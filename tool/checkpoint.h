@@ -0,0 +1,99 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <stack>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "permutation.h"
+
+// the state of search and keccak in the middle of a restart
+struct CheckpointState {
+  CheckpointState();
+
+  unsigned int restart_;
+  int total_iterations_;
+  double best_prob_;
+  unsigned int credits_;
+  unsigned int curr_credit_;
+  unsigned int restart_guesses_;
+  bool backtrack_;
+  SboxPos backtrack_box_;
+  std::string generator_;   // state of the generator of the search
+  std::string statistics_;  // counts of the learned guesses
+  std::string restarts_;    // state of the restart policy
+  std::string activity_;    // contradictions of the boxes for carry weights
+  std::unique_ptr<Permutation> best_;
+  std::unique_ptr<Permutation> start_;    // the restart starts over from it
+  std::unique_ptr<Permutation> carried_;  // for the next restarts
+  std::vector<double> top_bias_;
+  std::vector<std::unique_ptr<Permutation>> top_;
+  std::vector<std::unique_ptr<Permutation>> stack_;  // the bottom first
+};
+
+// writes the state of a search every interval seconds to a binary file, the
+// characteristics of the stack are stored as the words which differ from the
+// one below them, the file is written by a background thread and failures
+// are reported on the next save
+struct SearchCheckpoint {
+  SearchCheckpoint(const std::string& filename, int interval,
+                   std::ostream& out);
+  ~SearchCheckpoint();
+  bool Enabled() const;
+  bool Due() const;
+  void Save(const std::string& config, CheckpointState& state,
+            std::stack<std::unique_ptr<Permutation>>& char_stack);
+  static bool Load(const std::string& filename, const std::string& config,
+                   Permutation* prototype, CheckpointState& state,
+                   std::ostream& out);
+
+ private:
+  void Write();
+  void ReportFailure();
+
+  std::string filename_;
+  std::ostream& out_;
+  std::chrono::seconds interval_;
+  std::chrono::steady_clock::time_point last_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::string pending_;  // only the newest checkpoint waits to be written
+  bool has_pending_;
+  bool finished_;
+  bool failed_;  // set by the writer, reported by the search
+  std::thread writer_;
+};
+
+#endif /* CHECKPOINT_H_ */
@@ -55,6 +55,13 @@ const char* Commandlineparser::getParameter(std::string parameter_switch) {
   return it->second.value;
 }
 
+void Commandlineparser::setParameter(std::string parameter_switch,
+                                     const char* value) {
+  auto it = params_.find(parameter_switch);
+  assert(it != params_.end());
+  it->second.value = value;
+}
+
 int Commandlineparser::getIntParameter(std::string parameter_switch) {
   return atoi(getParameter(parameter_switch));
 }
@@ -46,6 +46,7 @@ struct Commandlineparser {
   Commandlineparser(std::string description);
   void addParameter(std::string parameter_switch, std::string helptext, const char* parameter);
   const char* getParameter(std::string parameter_switch);
+  void setParameter(std::string parameter_switch, const char* value);
   int getIntParameter(std::string parameter_switch);
   float getFloatParameter(std::string parameter_switch);
   bool getBoolParameter(std::string parameter_switch);
@@ -27,14 +27,51 @@ For more information, please refer to <http://unlicense.org/>
 
 #include "configparser.h"
 
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+// the S-box tables and linear steps of a permutation are built once per
+// process, every search file of a batch gets a clone of the same
+// unconstrained one
+std::unique_ptr<Permutation> Blank(const std::string& instance, int rounds) {
+  static std::mutex mutex;
+  static std::map<std::pair<std::string, int>,
+                  std::unique_ptr<Permutation>> prototypes;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<Permutation>& prototype =
+      prototypes[std::make_pair(instance, rounds)];
+  if (prototype == nullptr)
+    prototype.reset(permutation_list(instance, rounds));
+  return prototype->clone();
+}
+
+}
+
 Configparser::Configparser()
     : credits_(1000),
+      beam_width_(16),
+      nogoods_(0),
+      max_active_(0),
+      canonical_(false),
+      middle_state_(0),
+      forward_credits_(1000),
+      backward_credits_(1000),
+      learn_weight_(0),
+      learn_decay_(0.9),
+      restart_("fixed"),
+      restart_factor_(2),
+      carry_("none"),
       print_active_(false) {
   settings_.clear();
 }
 
-bool Configparser::parseFile(std::string filename) {
+bool Configparser::parseFile(std::string filename, bool echo, bool shared) {
   settings_.clear();
+  phases_.clear();
+  phase_shares_.clear();
   tinyxml2::XMLDocument doc;
   doc.LoadFile(filename.data());
 
@@ -43,7 +80,9 @@ bool Configparser::parseFile(std::string filename) {
     return Error( { "Problem with ", filename.data(), ". "});
   }
 
-  doc.Print();
+  // the machine readable output formats leave out the search file
+  if (echo)
+    doc.Print();
 
   tinyxml2::XMLElement* root =
       doc.FirstChildElement("config") ?
@@ -65,7 +104,12 @@ bool Configparser::parseFile(std::string filename) {
     std::string instance { parameters->FirstChildElement("permutation")
         ->Attribute("value") };
 
-    perm_.reset(permutation_list(instance, rounds));
+    if (shared)
+      perm_ = Blank(instance, rounds);
+    else
+      perm_.reset(permutation_list(instance, rounds));
+    permutation_name_ = instance;
+    TRACE_TARGET(instance);
   }
 
   if (root->FirstChildElement("char") != nullptr) {
@@ -139,6 +183,78 @@ bool Configparser::parseFile(std::string filename) {
 
 //    std::cout << "Credits:" << credits_ << std::endl;
 
+    beam_width_ =
+        root->FirstChildElement("search")->UnsignedAttribute("beam_width") ?
+            root->FirstChildElement("search")->UnsignedAttribute("beam_width") :
+            16;
+
+    nogoods_ =
+        root->FirstChildElement("search")->UnsignedAttribute("nogoods") ?
+            root->FirstChildElement("search")->UnsignedAttribute("nogoods") :
+            0;
+
+    max_active_ =
+        root->FirstChildElement("search")->UnsignedAttribute("max_active") ?
+            root->FirstChildElement("search")->UnsignedAttribute("max_active") :
+            0;
+
+    canonical_ =
+        root->FirstChildElement("search")->BoolAttribute("canonical") ?
+            root->FirstChildElement("search")->BoolAttribute("canonical") :
+            false;
+
+    // state 0 is a valid middle state, so only a missing attribute gives the
+    // default
+    middle_state_ = rounds;
+    tinyxml2::XMLError middle_state =
+        root->FirstChildElement("search")->QueryUnsignedAttribute(
+            "middle_state", &middle_state_);
+    if (middle_state != tinyxml2::XML_SUCCESS
+        && middle_state != tinyxml2::XML_NO_ATTRIBUTE)
+      return Error( { "middle_state has to be a number" });
+    if (middle_state_ > (unsigned int) (2 * rounds))
+      return Error( { "middle_state has to be at most ",
+          std::to_string(2 * rounds) });
+
+    forward_credits_ =
+        root->FirstChildElement("search")->UnsignedAttribute("forward_credits") ?
+            root->FirstChildElement("search")->UnsignedAttribute("forward_credits") :
+            credits_;
+
+    backward_credits_ =
+        root->FirstChildElement("search")->UnsignedAttribute("backward_credits") ?
+            root->FirstChildElement("search")->UnsignedAttribute("backward_credits") :
+            credits_;
+
+    learn_weight_ =
+        root->FirstChildElement("search")->FloatAttribute("learn_weight") ?
+            root->FirstChildElement("search")->FloatAttribute("learn_weight") :
+            0;
+
+    learn_decay_ =
+        root->FirstChildElement("search")->FloatAttribute("learn_decay") ?
+            root->FirstChildElement("search")->FloatAttribute("learn_decay") :
+            0.9;
+
+    restart_ =
+        root->FirstChildElement("search")->Attribute("restart") ?
+            root->FirstChildElement("search")->Attribute("restart") :
+            "fixed";
+    if (RestartPolicy::Known(restart_) == false)
+      return Error( { "unknown restart policy ", restart_ });
+
+    restart_factor_ =
+        root->FirstChildElement("search")->FloatAttribute("restart_factor") ?
+            root->FirstChildElement("search")->FloatAttribute("restart_factor") :
+            2;
+
+    carry_ =
+        root->FirstChildElement("search")->Attribute("carry") ?
+            root->FirstChildElement("search")->Attribute("carry") :
+            "none";
+    if (carry_ != "none" && carry_ != "partial" && carry_ != "weights")
+      return Error( { "unknown carry ", carry_ });
+
     print_active_ =
         root->FirstChildElement("search")->BoolAttribute("print_active") ?
             root->FirstChildElement("search")->BoolAttribute("print_active") :
@@ -147,51 +263,68 @@ bool Configparser::parseFile(std::string filename) {
 
     tinyxml2::XMLElement* phase = root->FirstChildElement("search")
         ->FirstChildElement("phase");
-    tinyxml2::XMLElement* setting = phase->FirstChildElement("setting");
-    while (setting != nullptr) {
-      Setting set;
-      set.guess_weights_.resize(rounds);
-      for (auto& entry : set.guess_weights_)
-        entry[0] = entry[1] = 0;
-
-      set.push_stack_probability_ =
-          setting->FloatAttribute("push_stack") ?
-              setting->FloatAttribute("push_stack") : 0.05;
+    while (phase != nullptr) {
+      settings_.clear();
+      tinyxml2::XMLElement* setting = phase->FirstChildElement("setting");
+      while (setting != nullptr) {
+        Setting set;
+        set.guess_weights_.resize(rounds);
+        for (auto& entry : set.guess_weights_)
+          entry[0] = entry[1] = 0;
+
+        set.push_stack_probability_ =
+            setting->FloatAttribute("push_stack") ?
+                setting->FloatAttribute("push_stack") : 0.05;
 //      std::cout << "Setting pushstack prob: " << set.push_stack_probability_
 //                << std::endl;
 
-      set.alternative_sbox_guesses_ =
-          setting->UnsignedAttribute("alternative_sbox_guesses") ?
-              setting->UnsignedAttribute("alternative_sbox_guesses") : 3;
+        set.alternative_sbox_guesses_ =
+            setting->UnsignedAttribute("alternative_sbox_guesses") ?
+                setting->UnsignedAttribute("alternative_sbox_guesses") : 3;
 //      std::cout << "Setting alternative sboxguesses: "
 //                << set.alternative_sbox_guesses_ << std::endl;
 
-      set.sbox_weight_hamming_ =
-          setting->UnsignedAttribute("sbox_weight_hamming") ?
-              setting->UnsignedAttribute("sbox_weight_hamming") : 1;
+        set.sbox_weight_hamming_ =
+            setting->UnsignedAttribute("sbox_weight_hamming") ?
+                setting->UnsignedAttribute("sbox_weight_hamming") : 1;
 //      std::cout
 //          << "Setting weight for sbox selection considering hammingweight: "
 //          << set.sbox_weight_hamming_ << std::endl;
 
-      set.sbox_weight_probability_ =
-          setting->UnsignedAttribute("sbox_weight_probability") ?
-              setting->UnsignedAttribute("sbox_weight_probability") : 2;
+        set.sbox_weight_probability_ =
+            setting->UnsignedAttribute("sbox_weight_probability") ?
+                setting->UnsignedAttribute("sbox_weight_probability") : 2;
+
+        std::string selection =
+            setting->Attribute("selection") ?
+                setting->Attribute("selection") : "random";
+        if (selection != "random" && selection != "constrained")
+          return Error( { "unknown selection ", selection });
+        set.constrained_first_ = selection == "constrained";
 //      std::cout << "Setting weight for sbox selection considering ldt entries: "
 //                << set.sbox_weight_probability_ << std::endl;
 
-      tinyxml2::XMLElement* guess = setting->FirstChildElement("guess");
-
-      while (guess != nullptr) {
-        assert(guess->IntAttribute("sbox_layer") < rounds);
-        set.guess_weights_[guess->IntAttribute("sbox_layer")][0] = guess
-            ->FloatAttribute("inactive_weight");
-        set.guess_weights_[guess->IntAttribute("sbox_layer")][1] = guess
-            ->FloatAttribute("active_weight");
-        guess = guess->NextSiblingElement("guess");
+        tinyxml2::XMLElement* guess = setting->FirstChildElement("guess");
+
+        while (guess != nullptr) {
+          assert(guess->IntAttribute("sbox_layer") < rounds);
+          set.guess_weights_[guess->IntAttribute("sbox_layer")][0] = guess
+              ->FloatAttribute("inactive_weight");
+          set.guess_weights_[guess->IntAttribute("sbox_layer")][1] = guess
+              ->FloatAttribute("active_weight");
+          guess = guess->NextSiblingElement("guess");
+        }
+        settings_.push_back(set);
+        setting = setting->NextSiblingElement("setting");
       }
-      settings_.push_back(set);
-      setting = setting->NextSiblingElement("setting");
+      phases_.push_back(settings_);
+      phase_shares_.push_back(
+          phase->FloatAttribute("time_share") ?
+              phase->FloatAttribute("time_share") : 1);
+      phase = phase->NextSiblingElement("phase");
     }
+    if (phases_.empty() == false)
+      settings_ = phases_.front();
   }
 
 //  for (auto& set : settings_) {
@@ -207,14 +340,74 @@ std::unique_ptr<Permutation> Configparser::getPermutation() {
   assert(perm_.get() != nullptr);
   return perm_->clone();
 }
+std::string Configparser::getPermutationName() {
+  return permutation_name_;
+}
+
 Settings Configparser::getSettings() {
   return settings_;
 }
 
+std::vector<Settings> Configparser::getPhases() {
+  return phases_;
+}
+
+std::vector<float> Configparser::getPhaseShares() {
+  return phase_shares_;
+}
+
 unsigned int Configparser::getCredits() {
   return credits_;
 }
 
+unsigned int Configparser::getBeamWidth() {
+  return beam_width_;
+}
+
+unsigned int Configparser::getNogoods() {
+  return nogoods_;
+}
+
+unsigned int Configparser::getMaxActive() {
+  return max_active_;
+}
+
+bool Configparser::getCanonical() {
+  return canonical_;
+}
+
+unsigned int Configparser::getMiddleState() {
+  return middle_state_;
+}
+
+unsigned int Configparser::getForwardCredits() {
+  return forward_credits_;
+}
+
+unsigned int Configparser::getBackwardCredits() {
+  return backward_credits_;
+}
+
+float Configparser::getLearnWeight() {
+  return learn_weight_;
+}
+
+float Configparser::getLearnDecay() {
+  return learn_decay_;
+}
+
+std::string Configparser::getRestart() {
+  return restart_;
+}
+
+float Configparser::getRestartFactor() {
+  return restart_factor_;
+}
+
+std::string Configparser::getCarry() {
+  return carry_;
+}
+
 bool Configparser::Error(std::initializer_list<std::string> msg) {
   std::cerr << "Config Error: ";
   for (const auto& m : msg)
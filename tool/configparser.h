@@ -37,21 +37,53 @@ For more information, please refer to <http://unlicense.org/>
 #include "permutation.h"
 #include "guessmask.h"
 #include "permutation_list.h"
+#include "restart.h"
+#include "trace.h"
 
 
 struct Configparser {
   Configparser();
-  bool parseFile(std::string filename);
+  bool parseFile(std::string filename, bool echo = true, bool shared = false);
   std::unique_ptr<Permutation> getPermutation();
+  std::string getPermutationName();
   Settings getSettings();
+  std::vector<Settings> getPhases();
+  std::vector<float> getPhaseShares();
   unsigned int getCredits();
+  unsigned int getBeamWidth();
+  unsigned int getNogoods();
+  unsigned int getMaxActive();
+  bool getCanonical();
+  unsigned int getMiddleState();
+  unsigned int getForwardCredits();
+  unsigned int getBackwardCredits();
+  float getLearnWeight();
+  float getLearnDecay();
+  std::string getRestart();
+  float getRestartFactor();
+  std::string getCarry();
   bool printActive();
   bool Error(std::initializer_list<std::string> msg);
   bool Warning(std::initializer_list<std::string> msg);
 
   std::unique_ptr<Permutation> perm_;
+  std::string permutation_name_;
   Settings settings_;
+  std::vector<Settings> phases_;
+  std::vector<float> phase_shares_;
   unsigned int credits_;
+  unsigned int beam_width_;
+  unsigned int nogoods_;
+  unsigned int max_active_;
+  bool canonical_;
+  unsigned int middle_state_;
+  unsigned int forward_credits_;
+  unsigned int backward_credits_;
+  float learn_weight_;
+  float learn_decay_;
+  std::string restart_;
+  float restart_factor_;
+  std::string carry_;
   bool print_active_;
 };
 
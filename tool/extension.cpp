@@ -0,0 +1,128 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "extension.h"
+
+#include <fstream>
+#include <iostream>
+
+#include "permutation_list.h"
+
+RoundExtension::RoundExtension(const std::string& name)
+    : name_(name) {
+}
+
+bool RoundExtension::ReadTrails(
+    const std::string& filename, unsigned int rounds,
+    std::vector<std::unique_ptr<Permutation>>& trails) const {
+  // one state per line with '0', '1' and '?' like the char value of a search
+  // file, 2 * rounds + 1 lines make up a characteristic, other characters and
+  // empty lines are skipped
+  std::ifstream file(filename);
+  if (file.is_open() == false) {
+    std::cout << "Cannot open " << filename << std::endl;
+    return false;
+  }
+  std::unique_ptr<Permutation> trail;
+  unsigned int state = 0;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find_first_of("01?") == std::string::npos)
+      continue;
+    if (trail.get() == nullptr) {
+      trail.reset(permutation_list(name_, rounds));
+      state = 0;
+    }
+    unsigned int state_bits = trail->state_masks_[0]->getnumwords()
+        * trail->state_masks_[0]->getnumbits();
+    unsigned int bit_pos = state * state_bits;
+    for (char val : line) {
+      BitMask bm;
+      if (val == '?')
+        bm = BM_DUNNO;
+      else if (val == '0')
+        bm = BM_0;
+      else if (val == '1')
+        bm = BM_1;
+      else
+        continue;
+      if (bit_pos == (state + 1) * state_bits
+          || trail->setBit(bm, bit_pos) == false) {
+        std::cout << "State " << state << " of characteristic "
+                  << trails.size() + 1 << " is too long" << std::endl;
+        return false;
+      }
+      ++bit_pos;
+    }
+    if (++state == 2 * rounds + 1) {
+      trail->touchall();
+      if (trail->update() == false) {
+        std::cout << "Characteristic " << trails.size() + 1
+                  << " is not valid" << std::endl;
+        return false;
+      }
+      trails.emplace_back(std::move(trail));
+    }
+  }
+  if (trail.get() != nullptr) {
+    std::cout << "The last characteristic has only " << state << " states"
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool RoundExtension::Extend(Permutation* trail, bool append,
+                            std::unique_ptr<Permutation>& result) const {
+  // the states of the trail are shifted by one round if a round is prepended
+  result.reset(permutation_list(name_, trail->rounds_ + 1));
+  result->canonical_ = trail->canonical_;
+  result->statistics_ = trail->statistics_;
+  unsigned int offset = append ? 0 : 2;
+  for (unsigned int i = 0; i < trail->state_masks_.size(); ++i) {
+    StateMaskBase& state = *trail->state_masks_[i];
+    unsigned int bits = state.getnumbits();
+    unsigned int bit_pos = (i + offset) * state.getnumwords() * bits;
+    for (unsigned int w = 0; w < state.getnumwords(); ++w)
+      for (unsigned int b = 0; b < bits; ++b, ++bit_pos)
+        result->setBit(state[w].bitmasks[bits - 1 - b], bit_pos);
+  }
+  result->touchall();
+  return result->update();
+}
+
+Settings RoundExtension::ExtendSettings(const Settings& settings,
+                                        unsigned int rounds) const {
+  // a new round is guessed like the nearest round of the given settings
+  Settings extended = settings;
+  for (auto& setting : extended) {
+    if (setting.guess_weights_.empty())
+      continue;
+    while (setting.guess_weights_.size() < rounds)
+      setting.guess_weights_.push_back(setting.guess_weights_.back());
+  }
+  return extended;
+}
@@ -0,0 +1,51 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef EXTENSION_H_
+#define EXTENSION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "permutation.h"
+#include "guessmask.h"
+
+// grows characteristics by one round, the known rounds are kept fixed and
+// only the new round at the beginning or at the end is left undetermined
+struct RoundExtension {
+  RoundExtension(const std::string& name);
+  bool ReadTrails(const std::string& filename, unsigned int rounds,
+                  std::vector<std::unique_ptr<Permutation>>& trails) const;
+  bool Extend(Permutation* trail, bool append,
+              std::unique_ptr<Permutation>& result) const;
+  Settings ExtendSettings(const Settings& settings, unsigned int rounds) const;
+
+ private:
+  std::string name_;  // the permutation as named in the configuration
+};
+
+#endif /* EXTENSION_H_ */
@@ -26,7 +26,44 @@ For more information, please refer to <http://unlicense.org/>
 */
 #include "guessmask.h"
 
+#include <iomanip>
+
+BoxActivity::BoxActivity(Permutation *perm) {
+  activity_.resize(perm->sbox_layers_.size());
+  for (size_t layer = 0; layer < perm->sbox_layers_.size(); ++layer)
+    activity_[layer].resize(perm->sbox_layers_[layer]->GetNumSteps(), 0);
+}
+
+void BoxActivity::Bump(SboxPos box) {
+  activity_[box.layer_][box.pos_] += 1;
+}
+
+void BoxActivity::Decay() {
+  for (auto& layer : activity_)
+    for (auto& box : layer)
+      box /= 2;
+}
+
+float BoxActivity::getWeight(SboxPos box) const {
+  return 1 + activity_[box.layer_][box.pos_];
+}
+
+void BoxActivity::Read(std::istream& stream) {
+  for (auto& layer : activity_)
+    for (auto& box : layer)
+      stream >> box;
+}
+
+void BoxActivity::Write(std::ostream& stream) const {
+  for (const auto& layer : activity_)
+    for (float box : layer)
+      stream << std::setprecision(9) << box << " ";
+}
+
+//-----------------------------------------------------------------------------
+
 int GuessMask::createMask(Permutation *perm, Settings& settings){
+  TRACE_SCOPE("GuessMask::createMask");
 
   weighted_pos_.clear();
   total_weight_ = 0;
@@ -37,25 +74,71 @@ int GuessMask::createMask(Permutation *perm, Settings& settings){
     for (int i = 0; i < 2; ++i) {
       for (auto& box : temp_active_boxes_[i]) {
         if (set.guess_weights_[box.layer_][i] != 0) {
-          total_weight_ += set.guess_weights_[box.layer_][i];
-          weighted_pos_.push_back(std::tuple<SboxPos, float, bool>(box, set.guess_weights_[box.layer_][i], i==1 ));
+          float weight = set.guess_weights_[box.layer_][i];
+          if (activity_ != nullptr)
+            weight *= activity_->getWeight(box);
+          total_weight_ += weight;
+          weighted_pos_.push_back(std::tuple<SboxPos, float, bool>(box, weight, i==1 ));
         }
       }
     }
     if(total_weight_ != 0){
       current_setting_ = &set;
+      if (set.constrained_first_)
+        KeepConstrained(perm);
       return 1;
     }
   }
 
   return 0;
 }
+void GuessMask::KeepConstrained(Permutation *perm) {
+  // the boxes with the fewest compatible masks are guessed first, the weights
+  // only break ties between them
+  unsigned int fewest = ~0U;
+  std::vector<unsigned int> options;
+  for (const auto& entry : weighted_pos_) {
+    SboxPos box = std::get<0>(entry);
+    options.push_back(perm->sbox_layers_[box.layer_]->SboxOptions(box.pos_));
+    fewest = std::min(fewest, options.back());
+  }
+  auto option = options.begin();
+  total_weight_ = 0;
+  for (auto it = weighted_pos_.begin(); it != weighted_pos_.end(); ++option) {
+    if (*option != fewest) {
+      it = weighted_pos_.erase(it);
+    } else {
+      total_weight_ += std::get<1>(*it);
+      ++it;
+    }
+  }
+}
+
 int GuessMask::getRandPos(SboxPos& box, bool& active) {
+  // a replayed trace names the box, the restart ends with its guesses
+  GuessTrace* trace = GuessTrace::Current();
+  if (trace != nullptr && trace->Replaying()) {
+    SboxPos next(0, 0);
+    if (trace->NextBox(next.layer_, next.pos_) == false)
+      return 0;
+    for (auto it = weighted_pos_.begin(); it != weighted_pos_.end(); ++it)
+      if (std::get<0>(*it).layer_ == next.layer_
+          && std::get<0>(*it).pos_ == next.pos_) {
+        box = next;
+        active = std::get<2>(*it);
+        total_weight_ -= std::get<1>(*it);
+        weighted_pos_.erase(it);
+        return 1;
+      }
+    // a box which is not guessable any more is not replaced by a random one,
+    // the search stops the replay unless it backtracks to this box
+    box = next;
+    active = false;
+    trace->Missing(next.layer_, next.pos_);
+    return 1;
+  }
   std::uniform_real_distribution<float> guessbox(0, total_weight_);
-
-  std::mt19937 generator(
-          std::chrono::high_resolution_clock::now().time_since_epoch().count());
-  float rand = guessbox(generator);
+  float rand = guessbox(Random::Generator());
   float current_weight = 0;
   for (auto it = weighted_pos_.begin(); it != weighted_pos_.end(); ++it) {
     current_weight += std::get<1>(*it);
@@ -84,3 +167,12 @@ float GuessMask::getSboxWeightHamming(){
 unsigned int GuessMask::getAlternativeSboxGuesses(){
   return current_setting_->alternative_sbox_guesses_;
 }
+
+std::function<int(int, int, int)> GuessMask::getRating(){
+  unsigned int wbias = getSboxWeigthProb();
+  unsigned int whamming = getSboxWeightHamming();
+  //FIXME: get rid of the 10
+  return [wbias, whamming] (int bias, int hw_in, int hw_out) {
+    return wbias*std::abs(bias) +whamming*((10-hw_in)+(10-hw_out));
+  };
+}
@@ -33,9 +33,13 @@ For more information, please refer to <http://unlicense.org/>
 #include <chrono>
 #include <random>
 #include <tuple>
+#include <algorithm>
+#include <functional>
+#include <iostream>
 
 #include "layer.h"
 #include "permutation.h"
+#include "random.h"
 
 
 
@@ -45,11 +49,26 @@ struct Setting {
   float sbox_weight_probability_;
   float sbox_weight_hamming_;
   unsigned int alternative_sbox_guesses_;
+  bool constrained_first_;  // only boxes with the fewest masks are guessed
 };
 
 typedef std::vector<Setting> Settings;
 
 
+// learned priority of the S-boxes which were guessed when a contradiction
+// occurred, boxes with a high activity are guessed earlier
+struct BoxActivity {
+  BoxActivity(Permutation *perm);
+  void Bump(SboxPos box);
+  void Decay();
+  float getWeight(SboxPos box) const;
+  void Read(std::istream& stream);
+  void Write(std::ostream& stream) const;
+
+  std::vector<std::vector<float>> activity_;
+};
+
+
 struct GuessMask {
 
   int createMask(Permutation *perm, Settings& settings);
@@ -58,11 +77,15 @@ struct GuessMask {
   float getSboxWeigthProb();
   float getSboxWeightHamming();
   unsigned int getAlternativeSboxGuesses();
+  // orders the masks of a guessed S-box, higher is tried first
+  std::function<int(int, int, int)> getRating();
+  void KeepConstrained(Permutation *perm);
 
 
   std::list<std::tuple<SboxPos,float, bool>> weighted_pos_;
   float total_weight_;
   Setting* current_setting_;
+  const BoxActivity* activity_ = nullptr;
 
  private:
   std::array<std::vector<SboxPos>,2> temp_active_boxes_;
@@ -0,0 +1,210 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "guessstatistics.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+GuessStatistics::GuessStatistics(float weight, float decay)
+    : weight_(weight),
+      decay_(decay) {
+}
+
+bool GuessStatistics::Enabled() const {
+  return weight_ != 0;
+}
+
+unsigned long long GuessStatistics::Pattern(const Mask& in, const Mask& out) {
+  // the bits which are fixed and the bits which are fixed to 1
+  unsigned int bits = in.bitmasks.size();
+  return ((in.caremask.canbe1 & in.caremask.care) << (3 * bits))
+      | (in.caremask.care << (2 * bits))
+      | ((out.caremask.canbe1 & out.caremask.care) << bits)
+      | out.caremask.care;
+}
+
+unsigned long long GuessStatistics::BoxKey(unsigned int layer,
+                                           unsigned long long pattern) {
+  return ((unsigned long long) layer << 32) | pattern;
+}
+
+unsigned int GuessStatistics::MaskKey(unsigned int in, unsigned int out) {
+  return (in << 8) | out;
+}
+
+int GuessStatistics::Bonus(const Counts& counts) const {
+  // the success rate with one success and one failure as prior, masks which
+  // were never tried get no bonus
+  float rate = (counts.success_ + 1)
+      / (counts.success_ + counts.failure_ + 2);
+  return (int) std::lround(weight_ * 2 * (rate - 0.5));
+}
+
+void GuessStatistics::Bonuses(unsigned int layer, unsigned long long pattern,
+                              std::vector<std::pair<unsigned int, int>>& bonuses) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto box = counts_.find(BoxKey(layer, pattern));
+    if (box == counts_.end())
+      return;
+    bonuses.reserve(box->second.size());
+    for (const auto& entry : box->second)
+      bonuses.emplace_back(entry.first, Bonus(entry.second));
+  }
+  std::sort(bonuses.begin(), bonuses.end());
+}
+
+int GuessStatistics::Failure(unsigned int layer, unsigned long long pattern,
+                             unsigned int in, unsigned int out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Counts& counts = counts_[BoxKey(layer, pattern)][MaskKey(in, out)];
+  counts.failure_ += 1;
+  return Bonus(counts);
+}
+
+void GuessStatistics::Success(std::shared_ptr<const GuessDecision> decisions) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const GuessDecision* decision = decisions.get(); decision != nullptr;
+      decision = decision->previous_.get())
+    counts_[BoxKey(decision->layer_, decision->pattern_)][MaskKey(
+        decision->in_, decision->out_)].success_ += 1;
+}
+
+void GuessStatistics::Decay() {
+  // old experience fades, so that the search keeps exploring
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto box = counts_.begin(); box != counts_.end();) {
+    for (auto it = box->second.begin(); it != box->second.end();) {
+      it->second.success_ *= decay_;
+      it->second.failure_ *= decay_;
+      if (it->second.success_ + it->second.failure_ < 0.01)
+        it = box->second.erase(it);
+      else
+        ++it;
+    }
+    if (box->second.empty())
+      box = counts_.erase(box);
+    else
+      ++box;
+  }
+}
+
+void GuessStatistics::Read(std::istream& stream) {
+  // one line per mask, the key is the one of the box shifted by 16 bits and
+  // the one of the masks
+  std::lock_guard<std::mutex> lock(mutex_);
+  unsigned long long key;
+  Counts counts;
+  while (stream >> key >> counts.success_ >> counts.failure_)
+    counts_[key >> 16][key & 0xffff] = counts;
+}
+
+void GuessStatistics::Write(std::ostream& stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& box : counts_)
+    for (const auto& entry : box.second)
+      stream << ((box.first << 16) | entry.first) << " "
+             << entry.second.success_ << " " << entry.second.failure_
+             << std::endl;
+}
+
+bool GuessStatistics::Load(const std::string& filename,
+                           const std::string& config) {
+  // the statistics are only valid for the configuration they were learned on
+  std::ifstream file(filename);
+  if (file.is_open() == false)
+    return false;
+  std::string header;
+  std::getline(file, header);
+  if (header != config) {
+    std::cout << "Statistics in " << filename << " belong to " << header
+              << std::endl;
+    return false;
+  }
+  Read(file);
+  return true;
+}
+
+bool GuessStatistics::Save(const std::string& filename,
+                           const std::string& config) {
+  // written to a temporary file first, so an interrupted run keeps the old one
+  std::string temporary = filename + ".tmp";
+  std::ofstream file(temporary);
+  if (file.is_open() == false)
+    return false;
+  file << config << std::endl;
+  Write(file);
+  file.close();
+  return file.good() && std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+size_t GuessStatistics::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t masks = 0;
+  for (const auto& box : counts_)
+    masks += box.second.size();
+  return masks;
+}
+
+//-----------------------------------------------------------------------------
+
+StatisticsOrdering::StatisticsOrdering(GuessStatistics* statistics,
+                                       unsigned int layer,
+                                       unsigned long long pattern)
+    : statistics_(statistics),
+      layer_(layer),
+      pattern_(pattern),
+      previous_(guess_ordering) {
+  statistics->Bonuses(layer, pattern, bonuses_);
+  guess_ordering = this;
+}
+
+StatisticsOrdering::~StatisticsOrdering() {
+  guess_ordering = previous_;
+}
+
+int StatisticsOrdering::Bonus(unsigned int in, unsigned int out) const {
+  unsigned int key = (in << 8) | out;
+  auto entry = std::lower_bound(bonuses_.begin(), bonuses_.end(),
+                                std::make_pair(key, INT_MIN));
+  return entry != bonuses_.end() && entry->first == key ? entry->second : 0;
+}
+
+void StatisticsOrdering::Failure(unsigned int in, unsigned int out) {
+  unsigned int key = (in << 8) | out;
+  int bonus = statistics_->Failure(layer_, pattern_, in, out);
+  auto entry = std::lower_bound(bonuses_.begin(), bonuses_.end(),
+                                std::make_pair(key, INT_MIN));
+  if (entry != bonuses_.end() && entry->first == key)
+    entry->second = bonus;
+  else
+    bonuses_.insert(entry, std::make_pair(key, bonus));
+}
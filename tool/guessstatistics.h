@@ -0,0 +1,109 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef GUESSSTATISTICS_H_
+#define GUESSSTATISTICS_H_
+
+#include <string>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+#include "mask.h"
+#include "step_nonlinear.h"
+
+// a successful guess of an S-box, the guesses of a characteristic form a list
+// which is shared by its copies
+struct GuessDecision {
+  unsigned int layer_;
+  unsigned long long pattern_;  // fixed bits of the box before the guess
+  unsigned int in_, out_;       // masks taken by the guess
+  std::shared_ptr<const GuessDecision> previous_;
+};
+
+// counts how often the masks taken for a pattern of an S-box led to a
+// contradiction or to a complete characteristic, masks which worked before
+// are rated higher by later guesses
+struct GuessStatistics {
+  GuessStatistics(float weight, float decay);
+  bool Enabled() const;
+  static unsigned long long Pattern(const Mask& in, const Mask& out);
+  // the bonus of every mask tried for the pattern of a box, keyed by
+  // in << 8 | out and sorted by the key
+  void Bonuses(unsigned int layer, unsigned long long pattern,
+               std::vector<std::pair<unsigned int, int>>& bonuses);
+  // returns the new bonus of the masks
+  int Failure(unsigned int layer, unsigned long long pattern,
+              unsigned int in, unsigned int out);
+  void Success(std::shared_ptr<const GuessDecision> decisions);
+  void Decay();
+  void Read(std::istream& stream);
+  void Write(std::ostream& stream);
+  bool Load(const std::string& filename, const std::string& config);
+  bool Save(const std::string& filename, const std::string& config);
+  size_t size();
+
+ private:
+  struct Counts {
+    float success_;
+    float failure_;
+  };
+  // the counts of the masks of one pattern are kept together, so that a
+  // guess copies them at once
+  typedef std::unordered_map<unsigned int, Counts> BoxCounts;
+  static unsigned long long BoxKey(unsigned int layer,
+                                   unsigned long long pattern);
+  static unsigned int MaskKey(unsigned int in, unsigned int out);
+  int Bonus(const Counts& counts) const;
+
+  std::mutex mutex_;
+  float weight_;
+  float decay_;
+  std::unordered_map<unsigned long long, BoxCounts> counts_;
+};
+
+// rates the masks of the box which is guessed by the current thread with a
+// copy of their bonuses, which is taken once per guess and follows the
+// failures of its alternatives
+struct StatisticsOrdering : public GuessOrdering {
+  StatisticsOrdering(GuessStatistics* statistics, unsigned int layer,
+                     unsigned long long pattern);
+  ~StatisticsOrdering();
+  int Bonus(unsigned int in, unsigned int out) const;
+  void Failure(unsigned int in, unsigned int out);
+
+ private:
+  GuessStatistics* statistics_;
+  unsigned int layer_;
+  unsigned long long pattern_;
+  std::vector<std::pair<unsigned int, int>> bonuses_;
+  const GuessOrdering* previous_;
+};
+
+#endif /* GUESSSTATISTICS_H_ */
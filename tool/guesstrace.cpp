@@ -0,0 +1,333 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "guesstrace.h"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#define GUESSTRACE_MAGIC   0x3154474c  // "LGT1"
+
+namespace {
+
+template <typename T>
+void Put(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool Get(const std::string& data, size_t& pos, T& value) {
+  if (pos + sizeof(T) > data.size())
+    return false;
+  std::memcpy(&value, data.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+unsigned long long Nanoseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+}
+
+thread_local GuessTrace* GuessTrace::current_ = nullptr;
+
+GuessEvent::GuessEvent()
+    : restart_(0),
+      layer_(0),
+      pos_(0),
+      choices_(0),
+      pick_(0),
+      alternative_(0),
+      flags_(0),
+      duration_(0),
+      time_(0) {
+}
+
+GuessTrace::GuessTrace(const std::string& record, const std::string& replay,
+                       const std::string& config)
+    : next_(0),
+      restart_(0),
+      pending_(false),
+      replaying_(replay.empty() == false),
+      failed_(false),
+      start_(std::chrono::steady_clock::now()),
+      guesses_(0),
+      diverged_(0),
+      first_diverged_(0),
+      guess_diverged_(false) {
+  if (replaying_) {
+    std::ifstream file(replay, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    size_t pos = 0;
+    uint32_t magic = 0, size = 0;
+    if (Get(data, pos, magic) == false || magic != GUESSTRACE_MAGIC) {
+      std::cout << replay << " is no guess trace" << std::endl;
+      failed_ = true;
+      return;
+    }
+    if (Get(data, pos, size) == false || pos + size > data.size()
+        || data.compare(pos, size, config) != 0) {
+      std::cout << "The guess trace " << replay << " belongs to "
+                << data.substr(pos, size) << std::endl;
+      failed_ = true;
+      return;
+    }
+    pos += size;
+    GuessEvent event;
+    while (Get(data, pos, event.restart_) && Get(data, pos, event.layer_)
+        && Get(data, pos, event.pos_) && Get(data, pos, event.choices_)
+        && Get(data, pos, event.pick_) && Get(data, pos, event.alternative_)
+        && Get(data, pos, event.flags_) && Get(data, pos, event.duration_)
+        && Get(data, pos, event.time_))
+      events_.push_back(event);
+  } else if (record.empty() == false) {
+    file_.open(record, std::ios::binary | std::ios::trunc);
+    if (file_.is_open() == false) {
+      std::cout << "Cannot write the guess trace " << record << std::endl;
+      failed_ = true;
+      return;
+    }
+    std::string header;
+    Put<uint32_t>(header, GUESSTRACE_MAGIC);
+    Put<uint32_t>(header, config.size());
+    header += config;
+    file_.write(header.data(), header.size());
+  }
+  if (Enabled())
+    current_ = this;
+}
+
+GuessTrace::~GuessTrace() {
+  Flush();
+  if (current_ == this)
+    current_ = nullptr;
+}
+
+bool GuessTrace::Enabled() const {
+  return replaying_ || file_.is_open();
+}
+
+bool GuessTrace::Replaying() const {
+  return replaying_;
+}
+
+bool GuessTrace::Failed() const {
+  return failed_;
+}
+
+GuessTrace* GuessTrace::Current() {
+  return current_;
+}
+
+bool GuessTrace::Restart(unsigned int restart) {
+  if (Enabled() == false)
+    return true;
+  if (replaying_) {
+    if (stopped_.empty() == false)
+      return false;
+    // the recorded guesses the replay did not get to
+    while (next_ < events_.size()
+        && (events_[next_].flags_ & GUESS_RESTART) == 0) {
+      next_++;
+      guess_diverged_ = false;
+      Diverged();
+    }
+    if (next_ == events_.size())
+      return false;
+    next_++;
+    restart_ = restart;
+  } else {
+    Flush();
+    restart_ = restart;
+    event_ = GuessEvent();
+    event_.restart_ = restart;
+    event_.flags_ = GUESS_RESTART;
+    event_.time_ = Nanoseconds(std::chrono::steady_clock::now() - start_);
+    pending_ = true;
+    Flush();
+  }
+  recorded_seconds_.push_back(0);
+  replayed_seconds_.push_back(0);
+  return true;
+}
+
+void GuessTrace::Guess(uint16_t layer, uint16_t pos) {
+  if (Enabled() == false)
+    return;
+  guesses_++;
+  guess_diverged_ = false;
+  guess_start_ = std::chrono::steady_clock::now();
+  missing_.clear();
+  if (replaying_) {
+    event_ = GuessEvent();
+    if (next_ < events_.size()
+        && (events_[next_].flags_ & GUESS_RESTART) == 0)
+      event_ = events_[next_++];
+    else
+      Diverged();
+    if (event_.layer_ != layer || event_.pos_ != pos)
+      Diverged();
+    return;
+  }
+  Flush();
+  event_ = GuessEvent();
+  event_.restart_ = restart_;
+  event_.layer_ = layer;
+  event_.pos_ = pos;
+  event_.time_ = Nanoseconds(guess_start_ - start_);
+  pending_ = true;
+}
+
+void GuessTrace::Outcome(bool success) {
+  if (Enabled() == false)
+    return;
+  unsigned long long duration =
+      Nanoseconds(std::chrono::steady_clock::now() - guess_start_);
+  if (replaying_) {
+    if (((event_.flags_ & GUESS_SUCCESS) != 0) != success)
+      Diverged();
+    replayed_seconds_.back() += duration / 1e9;
+  } else {
+    if (success)
+      event_.flags_ |= GUESS_SUCCESS;
+    event_.duration_ = duration < UINT32_MAX ? duration : UINT32_MAX;
+  }
+  recorded_seconds_.back() += event_.duration_ / 1e9;
+}
+
+bool GuessTrace::Push(bool push) {
+  if (replaying_)
+    return (event_.flags_ & GUESS_PUSHED) != 0;
+  if (push)
+    event_.flags_ |= GUESS_PUSHED;
+  return push;
+}
+
+bool GuessTrace::NextBox(uint16_t& layer, uint16_t& pos) const {
+  if (next_ == events_.size() || (events_[next_].flags_ & GUESS_RESTART))
+    return false;
+  layer = events_[next_].layer_;
+  pos = events_[next_].pos_;
+  return true;
+}
+
+unsigned int GuessTrace::Pick(unsigned int choices, unsigned int pick) {
+  if (replaying_) {
+    if (event_.choices_ != choices || event_.pick_ >= choices) {
+      Diverged();
+      return pick;
+    }
+    return event_.pick_;
+  }
+  event_.choices_ = choices;
+  event_.pick_ = pick;
+  return pick;
+}
+
+void GuessTrace::Alternative(unsigned int alternative) {
+  if (replaying_) {
+    if (event_.alternative_ != alternative)
+      Diverged();
+    return;
+  }
+  event_.alternative_ = alternative;
+}
+
+void GuessTrace::Missing(uint16_t layer, uint16_t pos) {
+  std::ostringstream reason;
+  reason << "the S-box " << pos << " of layer " << layer << " of guess "
+         << guesses_ + 1 << " in restart " << restart_ << " cannot be guessed";
+  missing_ = reason.str();
+}
+
+// the replay cannot follow the trace any further and ends with this restart
+bool GuessTrace::Stopped() {
+  if (missing_.empty() == false && stopped_.empty()) {
+    guesses_++;
+    guess_diverged_ = false;
+    Diverged();
+    stopped_ = missing_;
+  }
+  return stopped_.empty() == false;
+}
+
+void GuessTrace::Report(std::ostream& stream) const {
+  if (Enabled() == false)
+    return;
+  if (replaying_ == false) {
+    stream << "PRINT-INFO: recorded " << guesses_ << " guesses of "
+           << recorded_seconds_.size() << " restarts" << std::endl;
+    return;
+  }
+  stream << "PRINT-INFO: replayed " << guesses_ << " guesses of "
+         << recorded_seconds_.size() << " restarts, ";
+  if (diverged_)
+    stream << diverged_ << " diverged, the first was guess " << first_diverged_;
+  else
+    stream << "none diverged";
+  stream << std::endl;
+  if (stopped_.empty() == false)
+    stream << "PRINT-INFO: replay stopped, " << stopped_ << std::endl;
+  size_t slowest = 0;
+  for (size_t i = 0; i < recorded_seconds_.size(); ++i)
+    if (recorded_seconds_[i] > recorded_seconds_[slowest])
+      slowest = i;
+  if (recorded_seconds_.empty() == false)
+    stream << "PRINT-INFO: slowest restart " << slowest << " took "
+           << recorded_seconds_[slowest] << " s recorded, "
+           << replayed_seconds_[slowest] << " s replayed" << std::endl;
+}
+
+void GuessTrace::Flush() {
+  if (pending_ == false || file_.is_open() == false)
+    return;
+  std::string out;
+  Put(out, event_.restart_);
+  Put(out, event_.layer_);
+  Put(out, event_.pos_);
+  Put(out, event_.choices_);
+  Put(out, event_.pick_);
+  Put(out, event_.alternative_);
+  Put(out, event_.flags_);
+  Put(out, event_.duration_);
+  Put(out, event_.time_);
+  file_.write(out.data(), out.size());
+  pending_ = false;
+}
+
+// a guess is counted once, however many of its decisions differ
+void GuessTrace::Diverged() {
+  if (guess_diverged_)
+    return;
+  guess_diverged_ = true;
+  if (diverged_ == 0)
+    first_diverged_ = guesses_;
+  diverged_++;
+}
@@ -0,0 +1,110 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef GUESSTRACE_H_
+#define GUESSTRACE_H_
+
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define GUESS_SUCCESS 1  // the box could be guessed
+#define GUESS_PUSHED  2  // the guessed characteristic was pushed on the stack
+#define GUESS_RESTART 4  // no guess, a restart starts here
+
+// one decision of a restart, 26 bytes in the trace file
+struct GuessEvent {
+  GuessEvent();
+
+  uint32_t restart_;
+  uint16_t layer_;
+  uint16_t pos_;
+  uint16_t choices_;     // equally rated masks of the first alternative
+  uint16_t pick_;        // the one of them which was taken
+  uint8_t alternative_;  // the alternative which worked, or how many failed
+  uint8_t flags_;
+  uint32_t duration_;    // ns of the guess
+  uint64_t time_;        // ns since the start of the search
+};
+
+// records the decisions of the restarts of search and keccak to a binary
+// file, or replays such a file, then the boxes, the picks among equally rated
+// masks and the pushes are taken from the file instead of the generator and
+// the outcome of every guess is compared to the recorded one
+struct GuessTrace {
+  GuessTrace(const std::string& record, const std::string& replay,
+             const std::string& config);
+  ~GuessTrace();
+  bool Enabled() const;
+  bool Replaying() const;
+  bool Failed() const;
+
+  // called by the search, in the order of its decisions
+  bool Restart(unsigned int restart);
+  void Guess(uint16_t layer, uint16_t pos);
+  void Outcome(bool success);
+  bool Push(bool push);
+  void Report(std::ostream& stream) const;
+
+  // called by the guessing of the current thread
+  static GuessTrace* Current();
+  bool NextBox(uint16_t& layer, uint16_t& pos) const;
+  unsigned int Pick(unsigned int choices, unsigned int pick);
+  void Alternative(unsigned int alternative);
+  void Missing(uint16_t layer, uint16_t pos);
+  // called by the search when it does not backtrack, a missing box stops
+  // the replay
+  bool Stopped();
+
+ private:
+  void Flush();
+  void Diverged();
+
+  static thread_local GuessTrace* current_;
+  std::ofstream file_;
+  std::vector<GuessEvent> events_;  // of the replayed trace
+  size_t next_;
+  uint32_t restart_;
+  GuessEvent event_;                // the current guess
+  bool pending_;
+  bool replaying_;
+  bool failed_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point guess_start_;
+  unsigned long long guesses_;
+  unsigned long long diverged_;
+  unsigned long long first_diverged_;
+  bool guess_diverged_;
+  std::string missing_;  // the recorded box of the guess is not guessable
+  std::string stopped_;  // why the replay stopped early
+  std::vector<double> recorded_seconds_;  // per restart
+  std::vector<double> replayed_seconds_;
+};
+
+#endif /* GUESSTRACE_H_ */
@@ -0,0 +1,155 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "hull.h"
+
+#include <cmath>
+#include <deque>
+
+HullStatistics::HullStatistics()
+    : correlation_(0),
+      trails_(0) {
+}
+
+void HullStatistics::Add(double correlation) {
+  if (correlation == 0)
+    return;
+  correlation_ += correlation;
+  trails_++;
+  auto& entry = histogram_[(int) std::lround(-std::log2(std::abs(correlation)))];
+  entry.first++;
+  entry.second += correlation;
+}
+
+void HullStatistics::Merge(const HullStatistics& other) {
+  correlation_ += other.correlation_;
+  trails_ += other.trails_;
+  for (const auto& entry : other.histogram_) {
+    histogram_[entry.first].first += entry.second.first;
+    histogram_[entry.first].second += entry.second.second;
+  }
+}
+
+void HullStatistics::Print(std::ostream& stream) const {
+  for (const auto& entry : histogram_)
+    stream << "correlation 2^-" << entry.first << ": " << entry.second.first
+           << " trails, sum " << (double) entry.second.second << std::endl;
+  stream << "trails: " << trails_ << ", hull correlation: "
+         << (double) correlation_;
+  if (correlation_ != 0)
+    stream << " (bias 2^" << std::log2(std::abs((double) correlation_)) - 1
+           << ")";
+  stream << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+
+HullEnumerator::HullEnumerator(double threshold, SearchBudget& budget)
+    : nodes_(0),
+      threshold_(threshold),
+      budget_(budget) {
+}
+
+void HullEnumerator::Split(Permutation* perm, unsigned int parts,
+                           std::vector<std::unique_ptr<Permutation>>& work,
+                           HullStatistics& stats) {
+  // breadth-first until there are enough partial characteristics for all
+  // threads, complete characteristics on the way are counted right away
+  auto rating = [] (int bias, int hw_in, int hw_out) {
+    return std::abs(bias);
+  };
+  std::deque<std::unique_ptr<Permutation>> queue;
+  queue.emplace_back(perm->clone());
+  while (queue.empty() == false && queue.size() < parts) {
+    std::unique_ptr<Permutation> current = std::move(queue.front());
+    queue.pop_front();
+    nodes_++;
+    if (current->GetProbabilityBound() < threshold_)
+      continue;
+    SboxPos box(0, 0);
+    if (NextBox(current.get(), box) == false) {
+      stats.Add(current->GetCorrelation());
+      continue;
+    }
+    int total_alternatives = 1;
+    for (int alt = 0; alt < total_alternatives; ++alt) {
+      std::unique_ptr<Permutation> child = current->clone();
+      if (child->guessalternativesbox(box, rating, alt, total_alternatives))
+        queue.emplace_back(std::move(child));
+    }
+  }
+  for (auto& entry : queue)
+    work.emplace_back(std::move(entry));
+}
+
+void HullEnumerator::Enumerate(Permutation* perm, HullStatistics& stats) {
+  auto rating = [] (int bias, int hw_in, int hw_out) {
+    return std::abs(bias);
+  };
+
+  if (budget_.Terminate())
+    return;
+  nodes_++;
+  if (perm->GetProbabilityBound() < threshold_)
+    return;
+  SboxPos box(0, 0);
+  if (NextBox(perm, box) == false) {
+    stats.Add(perm->GetCorrelation());
+    return;
+  }
+
+  // the alternatives of a box are disjoint, so no characteristic is counted
+  // twice
+  int total_alternatives = 1;
+  for (int alt = 0; alt < total_alternatives; ++alt) {
+    std::unique_ptr<Permutation> child = perm->clone();
+    if (child->guessalternativesbox(box, rating, alt, total_alternatives))
+      Enumerate(child.get(), stats);
+  }
+}
+
+bool HullEnumerator::NextBox(Permutation* perm, SboxPos& box) {
+  // the box with the fewest undetermined bits has the fewest alternatives
+  unsigned int fewest = ~0U;
+  for (unsigned int layer = 0; layer < perm->sbox_layers_.size(); ++layer) {
+    SboxLayerBase* sbox_layer = perm->sbox_layers_[layer].get();
+    for (unsigned int pos = 0; pos < sbox_layer->GetNumSteps(); ++pos) {
+      if (sbox_layer->SboxGuessable(pos) == false)
+        continue;
+      Mask in(sbox_layer->GetVerticalMask(pos, *sbox_layer->in));
+      Mask out(sbox_layer->GetVerticalMask(pos, *sbox_layer->out));
+      unsigned int undetermined = 0;
+      for (unsigned int i = 0; i < in.bitmasks.size(); ++i)
+        undetermined += (in.bitmasks[i] == BM_DUNNO)
+            + (out.bitmasks[i] == BM_DUNNO);
+      if (undetermined < fewest) {
+        fewest = undetermined;
+        box = SboxPos(layer, pos);
+      }
+    }
+  }
+  return fewest != ~0U;
+}
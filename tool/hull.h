@@ -0,0 +1,71 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef HULL_H_
+#define HULL_H_
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <ostream>
+
+#include "permutation.h"
+#include "budget.h"
+
+// sum of the signed correlations of the characteristics of a hull, and how
+// many of them have which weight
+struct HullStatistics {
+  HullStatistics();
+  void Add(double correlation);
+  void Merge(const HullStatistics& other);
+  void Print(std::ostream& stream) const;
+
+  long double correlation_;
+  unsigned long long trails_;
+  // -log2 of the correlation -> number of trails and sum of correlations
+  std::map<int, std::pair<unsigned long long, long double>> histogram_;
+};
+
+// enumerates all characteristics of a partially determined characteristic
+// whose bias is at least threshold
+struct HullEnumerator {
+  HullEnumerator(double threshold, SearchBudget& budget);
+  void Split(Permutation* perm, unsigned int parts,
+             std::vector<std::unique_ptr<Permutation>>& work,
+             HullStatistics& stats);
+  void Enumerate(Permutation* perm, HullStatistics& stats);
+
+  std::atomic<unsigned long long> nodes_;
+
+ private:
+  bool NextBox(Permutation* perm, SboxPos& box);
+
+  double threshold_;
+  SearchBudget& budget_;
+};
+
+#endif /* HULL_H_ */
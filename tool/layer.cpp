@@ -27,6 +27,8 @@ For more information, please refer to <http://unlicense.org/>
 
 #include "layer.h"
 
+thread_local const GuessOrdering* guess_ordering = nullptr;
+
 SboxPos::SboxPos(uint16_t layer, uint16_t pos) : layer_(layer),pos_(pos){
 }
 
@@ -47,6 +49,7 @@ LinearLayer::LinearLayer(StateMaskBase *in, StateMaskBase *out) : Layer(in, out)
 }
 
 bool LinearLayer::Update(){
+  TRACE_SCOPE("LinearLayer::Update");
   bool ret_val = true;
 
   for(unsigned int i = 0; i < GetNumSteps(); ++i)
@@ -57,6 +60,12 @@ bool LinearLayer::Update(){
   return ret_val;
 }
 
+bool LinearLayer::Transform(const std::vector<BitVector>& x,
+                            std::vector<BitVector>& y) {
+  // the words of y = fun(x) of the steps, where in_i = <fun(e_i), out>
+  return false;
+}
+
 //-----------------------------------------------------------------------------
 
 SboxLayerBase::SboxLayerBase(StateMaskBase *in, StateMaskBase *out) : Layer(in, out) {
@@ -59,6 +59,7 @@ struct LinearLayer: public Layer {
   virtual bool updateStep(unsigned int step_pos) = 0;
   virtual unsigned int GetNumSteps() = 0;
   virtual void copyValues(LinearLayer* other) = 0;
+  virtual bool Transform(const std::vector<BitVector>& x, std::vector<BitVector>& y);
 };
 
 struct SboxLayerBase: public Layer {
@@ -74,6 +75,9 @@ struct SboxLayerBase: public Layer {
   virtual bool SboxGuessable(unsigned int step_pos)= 0;
   virtual SboxLayerBase* clone() = 0;
   virtual double GetProbability()= 0;
+  virtual double GetCorrelation()= 0;
+  virtual double GetProbabilityBound()= 0;
+  virtual unsigned int SboxOptions(unsigned int step_pos) = 0;
   virtual unsigned int GetNumSteps() = 0;
   virtual void SetSboxActive(unsigned int step_pos, bool active) = 0;
   virtual Mask GetVerticalMask(unsigned int b, const StateMaskBase& s) const  = 0;
@@ -96,6 +100,9 @@ struct SboxLayer: public SboxLayerBase {
   virtual bool SboxGuessable(unsigned int step_pos);
   virtual SboxLayer* clone() = 0;
   virtual double GetProbability();
+  virtual double GetCorrelation();
+  virtual double GetProbabilityBound();
+  virtual unsigned int SboxOptions(unsigned int step_pos);
   virtual unsigned int GetNumSteps();
   virtual void SetSboxActive(unsigned int step_pos, bool active);
   virtual Mask GetVerticalMask(unsigned int b, const StateMaskBase& s) const  = 0;
@@ -125,6 +132,42 @@ double SboxLayer<bits, boxes>::GetProbability(){
   return prob;
 }
 
+template <unsigned bits, unsigned boxes>
+double SboxLayer<bits, boxes>::GetCorrelation(){
+  double correlation = 1.0;
+
+  for (unsigned int i = 0; i < boxes; ++i){
+    Mask copyin(GetVerticalMask(i, *in));
+    Mask copyout(GetVerticalMask(i, *out));
+    correlation *= sboxes[i].GetCorrelation(copyin, copyout);
+  }
+
+  return correlation;
+}
+
+template <unsigned bits, unsigned boxes>
+double SboxLayer<bits, boxes>::GetProbabilityBound(){
+  double prob = {0.0};
+
+  // like GetProbability, but undetermined boxes take their best masks
+  for (unsigned int i = 0; i < boxes; ++i){
+    Mask copyin(GetVerticalMask(i, *in));
+    Mask copyout(GetVerticalMask(i, *out));
+    prob += sboxes[i].GetProbabilityBound(copyin, copyout);
+  }
+  prob += boxes-1;
+
+  return prob;
+}
+
+template <unsigned bits, unsigned boxes>
+unsigned int SboxLayer<bits, boxes>::SboxOptions(unsigned int step_pos){
+  assert(step_pos < boxes);
+  Mask copyin(GetVerticalMask(step_pos, *in));
+  Mask copyout(GetVerticalMask(step_pos, *out));
+  return sboxes[step_pos].CountCompatible(copyin, copyout);
+}
+
 template <unsigned bits, unsigned boxes>
 unsigned int SboxLayer<bits, boxes>::GetNumSteps(){
   return boxes;
@@ -144,6 +187,7 @@ bool SboxLayer<bits, boxes>::updateStep(unsigned int step_pos) {
 
 template <unsigned bits, unsigned boxes>
 bool SboxLayer<bits, boxes>::Update(){
+  TRACE_SCOPE("SboxLayer::Update");
   bool ret_val = true;
 
   for(unsigned int i = 0; i < boxes; ++i)
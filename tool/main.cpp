@@ -29,6 +29,8 @@ For more information, please refer to <http://unlicense.org/>
 #include <chrono>
 #include <cmath>
 #include <array>
+#include <cstring>
+#include <cstdlib>
 
 #include "mask.h"
 #include "step_linear.h"
@@ -38,12 +40,21 @@ For more information, please refer to <http://unlicense.org/>
 #include "search.h"
 #include "configparser.h"
 #include "commandlineparser.h"
+#include "metrics.h"
+#include "random.h"
+#include "batch.h"
+#include "benchmark.h"
 
 
+// the search file is only echoed next to human readable characteristics
+bool text_output(Commandlineparser& args) {
+  return std::strcmp(args.getParameter("--format"), "text") == 0;
+}
+
 void config_search(Commandlineparser& args) {
   Configparser parser;
 
-  bool config_ok = parser.parseFile(args.getParameter("-i"));
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
 
   if(config_ok == false)
     exit(config_ok);
@@ -55,7 +66,7 @@ void config_search(Commandlineparser& args) {
 void config_search_keccak(Commandlineparser& args) {
   Configparser parser;
 
-  bool config_ok = parser.parseFile(args.getParameter("-i"));
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
 
   if(config_ok == false)
       exit(config_ok);
@@ -64,10 +75,94 @@ void config_search_keccak(Commandlineparser& args) {
   my_search.StackSearchKeccak(args, parser);
 }
 
+void config_search_beam(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.BeamSearch(args, parser);
+}
+
+void config_search_twostage(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.TwoStageSearch(args, parser);
+}
+
+void config_tune(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.TuneSettings(args, parser);
+}
+
+void config_hull(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.HullSearch(args, parser);
+}
+
+void config_middle(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.MiddleOutSearch(args, parser);
+}
+
+void config_extend(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.ExtendSearch(args, parser);
+}
+
+void config_minactive(Commandlineparser& args) {
+  Configparser parser;
+
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
+
+  if(config_ok == false)
+      exit(config_ok);
+
+  Search my_search(*parser.getPermutation());
+  my_search.MinActiveSearch(args, parser);
+}
+
 void checkchar(Commandlineparser& args) {
   Configparser parser;
 
-  bool config_ok = parser.parseFile(args.getParameter("-i"));
+  bool config_ok = parser.parseFile(args.getParameter("-i"), text_output(args));
 
   if(config_ok == false)
       exit(config_ok);
@@ -88,14 +183,59 @@ int main(int argc, const char* argv[]) {
   args.addParameter("-I",    "Status update interval", "2");
 
   args.addParameter("-i",    "characteristic input file", "examples/ascon_3_rounds_typeI.xml");
-  args.addParameter("-u",    "requested function: checkchar, search", "search");
+  args.addParameter("-u",    "requested function: checkchar, search, keccak, beam, twostage, tune, hull, middle, extend, minactive, bench, batch", "search");
+  args.addParameter("--threads", "number of worker threads", "1");
+  args.addParameter("--arms", "number of settings tried by tune", "8");
+  args.addParameter("--time-budget", "wall clock seconds after which the search stops, 0 for unlimited", "0");
+  args.addParameter("--guess-budget", "number of S-box guesses after which the search stops, 0 for unlimited", "0");
+  args.addParameter("--seed", "seed of all random choices, 0 takes one from the clock", "0");
+  args.addParameter("--bench-dir", "directory whose search files bench runs", "examples");
+  args.addParameter("--target-bias", "log2 bias at which the search stops, 0 for none", "0");
+  args.addParameter("--hull-bias", "log2 bias of the worst characteristic counted by hull, 0 uses --hull-margin", "0");
+  args.addParameter("--hull-margin", "bits below the given characteristic counted by hull", "4");
+  args.addParameter("--trails", "file with characteristics extended by extend, one state per line", "");
+  args.addParameter("--extend-rounds", "number of rounds extend stops at, 0 for one more round", "0");
+  args.addParameter("--extend-restarts", "searches of extend per characteristic and direction", "10");
+  args.addParameter("--checkpoint", "file to which search and keccak write their state", "");
+  args.addParameter("--checkpoint-interval", "seconds between two checkpoints", "300");
+  args.addParameter("--resume", "checkpoint from which search and keccak continue", "");
+  args.addParameter("--batch", "directory or list of the search files of batch", "");
+  args.addParameter("--batch-out", "directory to which batch writes the output of every search file", "batch");
+  args.addParameter("--record", "file to which search and keccak record the decisions of their restarts", "");
+  args.addParameter("--replay", "recorded decisions which search and keccak repeat instead of guessing randomly", "");
+  args.addParameter("--format", "output of the reported characteristics: text, jsonl or binary", "text");
+  args.addParameter("--output", "file to which jsonl and binary characteristics are appended, - for stdout", "-");
+  args.addParameter("--metrics", "file or unix:<socket> to which the search metrics are exported", "");
+  args.addParameter("--metrics-format", "format of the metrics: json or prometheus", "json");
+  args.addParameter("--metrics-interval", "seconds between two exports of the metrics", "10");
+  args.addParameter("--trail-db", "database to which every reported characteristic is added", "");
+  args.addParameter("--seed-from", "database whose characteristics start the restarts of search and keccak", "");
+  args.addParameter("--statistics", "file which keeps the statistics of learn_weight between runs", "");
+  args.addParameter("--top", "number of best characteristics which are kept, 0 keeps none", "0");
 
   args.addParameter("-h",    "display help", nullptr);
 
   args.parse(argc, argv);
 
+  if (std::strtoull(args.getParameter("--seed"), nullptr, 10) != 0)
+    Random::Seed(std::strtoull(args.getParameter("--seed"), nullptr, 10));
+  // a seed taken from the clock is printed as well, so every run can be
+  // repeated, bench seeds each search file itself
+  if (args.getBoolParameter("-h") == false && argc > 1
+      && std::strcmp(args.getParameter("-u"), "bench") != 0)
+    std::cout << "Seed: " << Random::GetSeed() << std::endl;
+
+  MetricsExporter metrics(args.getParameter("--metrics"),
+                          args.getParameter("--metrics-format"),
+                          args.getIntParameter("--metrics-interval"));
+
   if (args.getBoolParameter("-h") || argc == 1) {
     args.print_help();
+  } else if (text_output(args) == false &&
+             std::strcmp(args.getParameter("--format"), "jsonl") != 0 &&
+             std::strcmp(args.getParameter("--format"), "binary") != 0) {
+    std::cout << "Unknown output format: " << args.getParameter("--format")
+              << std::endl;
   } else if (std::strcmp(args.getParameter("-u"), "checkchar") == 0) {
     std::cout << "Checking characteristic ... " << std::endl;
     std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
@@ -105,6 +245,46 @@ int main(int argc, const char* argv[]) {
     std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
     std::cout << "Iterations: " << args.getIntParameter("-iter") << std::endl;
     config_search_keccak(args);
+  } else if (std::strcmp(args.getParameter("-u"), "beam") == 0) {
+    std::cout << "Beam search ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    std::cout << "Iterations: " << args.getIntParameter("-iter") << std::endl;
+    config_search_beam(args);
+  } else if (std::strcmp(args.getParameter("-u"), "twostage") == 0) {
+    std::cout << "Two-stage search ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    std::cout << "Iterations: " << args.getIntParameter("-iter") << std::endl;
+    config_search_twostage(args);
+  } else if (std::strcmp(args.getParameter("-u"), "tune") == 0) {
+    std::cout << "Tuning settings ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    std::cout << "Iterations: " << args.getIntParameter("-iter") << std::endl;
+    config_tune(args);
+  } else if (std::strcmp(args.getParameter("-u"), "hull") == 0) {
+    std::cout << "Linear hull ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    config_hull(args);
+  } else if (std::strcmp(args.getParameter("-u"), "middle") == 0) {
+    std::cout << "Middle-out search ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    std::cout << "Iterations: " << args.getIntParameter("-iter") << std::endl;
+    config_middle(args);
+  } else if (std::strcmp(args.getParameter("-u"), "extend") == 0) {
+    std::cout << "Round extension ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    config_extend(args);
+  } else if (std::strcmp(args.getParameter("-u"), "bench") == 0) {
+    std::cout << "Benchmark ... " << std::endl;
+    Benchmark benchmark(args);
+    benchmark.Run(std::cout);
+  } else if (std::strcmp(args.getParameter("-u"), "batch") == 0) {
+    std::cout << "Batch ... " << std::endl;
+    Batch batch(args);
+    batch.Run(std::cout);
+  } else if (std::strcmp(args.getParameter("-u"), "minactive") == 0) {
+    std::cout << "Minimum number of active S-boxes ... " << std::endl;
+    std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
+    config_minactive(args);
   } else {
     std::cout << "Searching ... " << std::endl;
     std::cout << "Configfile: " << args.getParameter("-i") << std::endl;
@@ -0,0 +1,277 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include "metrics.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const char* metric_names[METRIC_COUNTERS] = {
+  "guesses",
+  "failed_guesses",
+  "propagations",
+  "sweeps",
+  "sbox_updates",
+  "linear_updates",
+  "sbox_cache_hits",
+  "sbox_cache_misses",
+  "nogood_hits",
+  "clones",
+  "saves",
+  "restores",
+  "characteristics"
+};
+
+// blocks of finished threads stay, so their counts are not lost
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<MetricsBlock>> registry;
+const std::chrono::steady_clock::time_point metrics_start =
+    std::chrono::steady_clock::now();
+
+double Ratio(uint64_t part, uint64_t whole) {
+  return whole ? double(part) / whole : 0.0;
+}
+
+// the layers after the last contradiction are left out
+std::vector<uint64_t> Trim(std::vector<uint64_t> counts) {
+  while (counts.empty() == false && counts.back() == 0)
+    counts.pop_back();
+  return counts;
+}
+
+bool SendToSocket(const std::string& path, const std::string& text) {
+  sockaddr_un address;
+  if (path.size() >= sizeof(address.sun_path))
+    return false;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  bool sent = connect(fd, (sockaddr*) &address, sizeof(address)) == 0;
+  for (size_t done = 0; sent && done < text.size();) {
+    ssize_t written = write(fd, text.data() + done, text.size() - done);
+    sent = written > 0;
+    done += sent ? written : 0;
+  }
+  close(fd);
+  return sent;
+}
+
+}  // namespace
+
+thread_local MetricsBlock* Metrics::local_ = nullptr;
+
+MetricsBlock::MetricsBlock()
+    : depth_sum_(0) {
+  for (auto& counter : counters_)
+    counter.store(0, std::memory_order_relaxed);
+  for (auto& counter : contradictions_)
+    counter.store(0, std::memory_order_relaxed);
+  for (auto& counter : depth_)
+    counter.store(0, std::memory_order_relaxed);
+}
+
+MetricsBlock* Metrics::Register() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  registry.emplace_back(new MetricsBlock());
+  return registry.back().get();
+}
+
+MetricsSnapshot Metrics::Read() {
+  MetricsSnapshot snapshot;
+  snapshot.seconds_ = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - metrics_start).count();
+  snapshot.counters_.fill(0);
+  snapshot.depth_.fill(0);
+  snapshot.depth_sum_ = 0;
+  std::vector<uint64_t> sbox(METRIC_MAX_STEPS / 2, 0);
+  std::vector<uint64_t> linear(METRIC_MAX_STEPS / 2, 0);
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (auto& block : registry) {
+    for (int i = 0; i < METRIC_COUNTERS; ++i)
+      snapshot.counters_[i] +=
+          block->counters_[i].load(std::memory_order_relaxed);
+    for (int i = 0; i < METRIC_MAX_STEPS; ++i)
+      (i % 2 ? linear : sbox)[i / 2] +=
+          block->contradictions_[i].load(std::memory_order_relaxed);
+    for (int i = 0; i < METRIC_DEPTH_BUCKETS; ++i)
+      snapshot.depth_[i] += block->depth_[i].load(std::memory_order_relaxed);
+    snapshot.depth_sum_ += block->depth_sum_.load(std::memory_order_relaxed);
+  }
+  snapshot.sbox_contradictions_ = Trim(sbox);
+  snapshot.linear_contradictions_ = Trim(linear);
+  return snapshot;
+}
+
+const char* Metrics::Name(MetricCounter counter) {
+  return metric_names[counter];
+}
+
+MetricsExporter::MetricsExporter(const std::string& target,
+                                 const std::string& format, int interval)
+    : target_(target),
+      prometheus_(format == "prometheus"),
+      interval_(interval > 0 ? interval : 1),
+      last_(Metrics::Read()),
+      finished_(false) {
+  if (Enabled())
+    exporter_ = std::thread(&MetricsExporter::Run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+  if (Enabled() == false)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+  }
+  wakeup_.notify_one();
+  exporter_.join();
+}
+
+bool MetricsExporter::Enabled() const {
+  return target_.empty() == false;
+}
+
+void MetricsExporter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (finished_ == false) {
+    wakeup_.wait_for(lock, interval_, [this] { return finished_; });
+    lock.unlock();
+    Export();
+    lock.lock();
+  }
+}
+
+void MetricsExporter::Export() {
+  MetricsSnapshot now = Metrics::Read();
+  double seconds = now.seconds_ - last_.seconds_;
+  double rate = seconds > 0 ? (now.counters_[METRIC_GUESSES]
+      - last_.counters_[METRIC_GUESSES]) / seconds : 0.0;
+  last_ = now;
+  std::string text = prometheus_ ? Prometheus(now, rate) : Json(now, rate);
+
+  bool written;
+  if (target_.compare(0, 5, "unix:") == 0) {
+    written = SendToSocket(target_.substr(5), text);
+  } else {
+    // readers never see a half written snapshot
+    std::string temporary = target_ + ".tmp";
+    std::ofstream file(temporary);
+    file << text;
+    file.close();
+    written = file.good()
+        && std::rename(temporary.c_str(), target_.c_str()) == 0;
+  }
+  if (written == false)
+    std::cout << "Exporting the metrics to " << target_ << " failed"
+              << std::endl;
+}
+
+std::string MetricsExporter::Json(const MetricsSnapshot& now,
+                                  double rate) const {
+  const auto& c = now.counters_;
+  std::ostringstream out;
+  out << "{\"seconds\":" << now.seconds_ << ",\"counters\":{";
+  for (int i = 0; i < METRIC_COUNTERS; ++i)
+    out << (i ? "," : "") << "\"" << Metrics::Name(MetricCounter(i))
+        << "\":" << c[i];
+  out << "},\"rates\":{\"guesses_per_second\":" << rate
+      << ",\"sweeps_per_guess\":"
+      << Ratio(c[METRIC_SWEEPS], c[METRIC_GUESSES])
+      << ",\"failed_guess_ratio\":"
+      << Ratio(c[METRIC_FAILED_GUESSES], c[METRIC_GUESSES])
+      << ",\"sbox_cache_hit_ratio\":"
+      << Ratio(c[METRIC_SBOX_CACHE_HITS],
+               c[METRIC_SBOX_CACHE_HITS] + c[METRIC_SBOX_CACHE_MISSES])
+      << "},\"contradictions\":{\"sbox\":[";
+  for (size_t i = 0; i < now.sbox_contradictions_.size(); ++i)
+    out << (i ? "," : "") << now.sbox_contradictions_[i];
+  out << "],\"linear\":[";
+  for (size_t i = 0; i < now.linear_contradictions_.size(); ++i)
+    out << (i ? "," : "") << now.linear_contradictions_[i];
+  out << "]},\"stack_depth\":[";
+  for (int i = 0; i < METRIC_DEPTH_BUCKETS; ++i)
+    out << (i ? "," : "") << now.depth_[i];
+  out << "]}" << std::endl;
+  return out.str();
+}
+
+std::string MetricsExporter::Prometheus(const MetricsSnapshot& now,
+                                        double rate) const {
+  const auto& c = now.counters_;
+  std::ostringstream out;
+  for (int i = 0; i < METRIC_COUNTERS; ++i) {
+    std::string name = std::string("lineartrails_")
+        + Metrics::Name(MetricCounter(i)) + "_total";
+    out << "# TYPE " << name << " counter\n" << name << " " << c[i] << "\n";
+  }
+
+  out << "# TYPE lineartrails_contradictions_total counter\n";
+  for (size_t i = 0; i < now.sbox_contradictions_.size(); ++i)
+    out << "lineartrails_contradictions_total{step=\"sbox\",layer=\"" << i
+        << "\"} " << now.sbox_contradictions_[i] << "\n";
+  for (size_t i = 0; i < now.linear_contradictions_.size(); ++i)
+    out << "lineartrails_contradictions_total{step=\"linear\",layer=\"" << i
+        << "\"} " << now.linear_contradictions_[i] << "\n";
+
+  uint64_t count = 0;
+  out << "# TYPE lineartrails_stack_depth histogram\n";
+  for (int i = 0; i < METRIC_DEPTH_BUCKETS - 1; ++i) {
+    count += now.depth_[i];
+    out << "lineartrails_stack_depth_bucket{le=\"" << (1u << i) - 1 << "\"} "
+        << count << "\n";
+  }
+  count += now.depth_[METRIC_DEPTH_BUCKETS - 1];
+  out << "lineartrails_stack_depth_bucket{le=\"+Inf\"} " << count << "\n"
+      << "lineartrails_stack_depth_sum " << now.depth_sum_ << "\n"
+      << "lineartrails_stack_depth_count " << count << "\n";
+
+  out << "# TYPE lineartrails_guesses_per_second gauge\n"
+      << "lineartrails_guesses_per_second " << rate << "\n"
+      << "# TYPE lineartrails_sbox_cache_hit_ratio gauge\n"
+      << "lineartrails_sbox_cache_hit_ratio "
+      << Ratio(c[METRIC_SBOX_CACHE_HITS],
+               c[METRIC_SBOX_CACHE_HITS] + c[METRIC_SBOX_CACHE_MISSES]) << "\n"
+      << "# TYPE lineartrails_uptime_seconds gauge\n"
+      << "lineartrails_uptime_seconds " << now.seconds_ << "\n";
+  return out.str();
+}
@@ -0,0 +1,154 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum MetricCounter {
+  METRIC_GUESSES,
+  METRIC_FAILED_GUESSES,
+  METRIC_PROPAGATIONS,
+  METRIC_SWEEPS,
+  METRIC_SBOX_UPDATES,
+  METRIC_LINEAR_UPDATES,
+  METRIC_SBOX_CACHE_HITS,
+  METRIC_SBOX_CACHE_MISSES,
+  METRIC_NOGOOD_HITS,
+  METRIC_CLONES,
+  METRIC_SAVES,
+  METRIC_RESTORES,
+  METRIC_CHARACTERISTICS,
+  METRIC_COUNTERS
+};
+
+#define METRIC_MAX_STEPS     128
+#define METRIC_DEPTH_BUCKETS 16
+
+// the counters of one thread, only the owning thread writes them, so an
+// increment is a relaxed load and store instead of a locked add
+struct MetricsBlock {
+  MetricsBlock();
+
+  std::atomic<uint64_t> counters_[METRIC_COUNTERS];
+  // S-box layer l is counted at 2l and linear layer l at 2l + 1
+  std::atomic<uint64_t> contradictions_[METRIC_MAX_STEPS];
+  // bucket b holds the stack depths below 2^b
+  std::atomic<uint64_t> depth_[METRIC_DEPTH_BUCKETS];
+  std::atomic<uint64_t> depth_sum_;
+};
+
+// the counters of all threads added up
+struct MetricsSnapshot {
+  double seconds_;
+  std::array<uint64_t, METRIC_COUNTERS> counters_;
+  std::vector<uint64_t> sbox_contradictions_;
+  std::vector<uint64_t> linear_contradictions_;
+  std::array<uint64_t, METRIC_DEPTH_BUCKETS> depth_;
+  uint64_t depth_sum_;
+};
+
+struct Metrics {
+  static void Count(MetricCounter counter, uint64_t amount = 1);
+  static void Contradiction(unsigned int layer, bool linear);
+  static void Depth(unsigned int depth);
+  static MetricsSnapshot Read();
+  static const char* Name(MetricCounter counter);
+
+ private:
+  static MetricsBlock& Local();
+  static MetricsBlock* Register();
+  static void Add(std::atomic<uint64_t>& counter, uint64_t amount);
+
+  static thread_local MetricsBlock* local_;
+};
+
+// writes a snapshot every interval seconds and at the end of the run, either
+// as JSON or as the Prometheus text format, to a file which is replaced as a
+// whole or to a local socket given as unix:<path>
+struct MetricsExporter {
+  MetricsExporter(const std::string& target, const std::string& format,
+                  int interval);
+  ~MetricsExporter();
+  bool Enabled() const;
+
+ private:
+  void Run();
+  void Export();
+  std::string Json(const MetricsSnapshot& now, double rate) const;
+  std::string Prometheus(const MetricsSnapshot& now, double rate) const;
+
+  std::string target_;
+  bool prometheus_;
+  std::chrono::seconds interval_;
+  MetricsSnapshot last_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  bool finished_;
+  std::thread exporter_;
+};
+
+inline void Metrics::Add(std::atomic<uint64_t>& counter, uint64_t amount) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+inline MetricsBlock& Metrics::Local() {
+  if (local_ == nullptr)
+    local_ = Register();
+  return *local_;
+}
+
+inline void Metrics::Count(MetricCounter counter, uint64_t amount) {
+  Add(Local().counters_[counter], amount);
+}
+
+inline void Metrics::Contradiction(unsigned int layer, bool linear) {
+  unsigned int step = 2 * layer + linear;
+  Add(Local().contradictions_[
+      step < METRIC_MAX_STEPS ? step : METRIC_MAX_STEPS - 1], 1);
+}
+
+inline void Metrics::Depth(unsigned int depth) {
+  unsigned int bucket = 0;
+  while (bucket < METRIC_DEPTH_BUCKETS - 1 && (depth >> bucket) != 0)
+    ++bucket;
+  MetricsBlock& block = Local();
+  Add(block.depth_[bucket], 1);
+  Add(block.depth_sum_, depth);
+}
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,133 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "middleout.h"
+
+#include <algorithm>
+
+MiddleCatalogue::MiddleCatalogue(Permutation* perm, unsigned int state)
+    : state_(state),
+      layer_(-1),
+      split_(0) {
+  // the S-box layers whose output is at most the middle state are before it
+  for (unsigned int layer = 0; layer < perm->sbox_layers_.size(); ++layer) {
+    SboxLayerBase* sbox_layer = perm->sbox_layers_[layer].get();
+    for (unsigned int i = 0; i <= state; ++i)
+      if (sbox_layer->out == perm->state_masks_[i].get())
+        split_ = layer + 1;
+    if (layer_ < 0 && (sbox_layer->in == perm->state_masks_[state].get()
+        || sbox_layer->out == perm->state_masks_[state].get()))
+      layer_ = layer;
+  }
+}
+
+bool MiddleCatalogue::Supported() const {
+  return layer_ >= 0;
+}
+
+void MiddleCatalogue::Build(Permutation* start, bool canonical) {
+  // a rotation invariant start only needs the boxes at bit position 0
+  SboxLayerBase* layer = start->sbox_layers_[layer_].get();
+  std::vector<unsigned int> boxes;
+  if (canonical && start->rotationInvariant())
+    boxes = start->anchorBoxes(layer_);
+  if (boxes.empty())
+    for (unsigned int box = 0; box < layer->GetNumSteps(); ++box)
+      boxes.push_back(box);
+
+  // the other boxes are zero for all patterns of a box and are propagated
+  // only once
+  patterns_.clear();
+  unsigned int bitsize =
+      layer->GetVerticalMask(0, *start->state_masks_[state_]).bitmasks.size();
+  for (unsigned int box : boxes) {
+    std::unique_ptr<Permutation> others(start->clone());
+    if (Fix(others.get(), box, 0, true) == false)
+      continue;
+    others->touchall();
+    if (others->update() == false)
+      continue;
+    for (BitVector value = 1; value < (1ULL << bitsize); ++value) {
+      std::unique_ptr<Permutation> seeded(others->clone());
+      if (Fix(seeded.get(), box, value, false) == false)
+        continue;
+      seeded->touchall();
+      if (seeded->update() == false)
+        continue;
+      patterns_.push_back({ box, value, seeded->GetProbabilityBound() });
+    }
+  }
+  std::stable_sort(patterns_.begin(), patterns_.end(),
+                   [] (const MiddlePattern& a, const MiddlePattern& b) {
+    return a.bound > b.bound;
+  });
+}
+
+bool MiddleCatalogue::Seed(Permutation* start, const MiddlePattern& pattern,
+                           std::unique_ptr<Permutation>& result) const {
+  result = start->clone();
+  if (Fix(result.get(), pattern.box, 0, true) == false
+      || Fix(result.get(), pattern.box, pattern.value, false) == false)
+    return false;
+  result->touchall();
+  return result->update();
+}
+
+bool MiddleCatalogue::Fix(Permutation* perm, unsigned int box,
+                          BitVector value, bool other_boxes) const {
+  // sets either the given box or all other boxes of the middle state
+  SboxLayerBase* layer = perm->sbox_layers_[layer_].get();
+  StateMaskBase& state = *perm->state_masks_[state_];
+  for (unsigned int pos = 0; pos < layer->GetNumSteps(); ++pos) {
+    if ((pos == box) == other_boxes)
+      continue;
+    Mask mask = layer->GetVerticalMask(pos, state);
+    for (unsigned int b = 0; b < mask.bitmasks.size(); ++b) {
+      BitMask bit = ((value >> b) & 1) ? BM_1 : BM_0;
+      if (mask.bitmasks[b] != BM_DUNNO && mask.bitmasks[b] != bit)
+        return false;
+      mask.bitmasks[b] = bit;
+    }
+    mask.reinit_caremask();
+    layer->SetVerticalMask(pos, state, mask);
+  }
+  return true;
+}
+
+void MiddleCatalogue::Split(const Settings& settings, Settings& backward,
+                            Settings& forward) const {
+  // every setting only guesses the boxes on its side of the middle state
+  backward = settings;
+  forward = settings;
+  for (auto& setting : backward)
+    for (unsigned int layer = split_; layer < setting.guess_weights_.size();
+        ++layer)
+      setting.guess_weights_[layer] = {{ 0, 0 }};
+  for (auto& setting : forward)
+    for (unsigned int layer = 0;
+        layer < split_ && layer < setting.guess_weights_.size(); ++layer)
+      setting.guess_weights_[layer] = {{ 0, 0 }};
+}
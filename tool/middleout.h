@@ -0,0 +1,66 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef MIDDLEOUT_H_
+#define MIDDLEOUT_H_
+
+#include <vector>
+#include <memory>
+
+#include "layer.h"
+#include "permutation.h"
+#include "guessmask.h"
+
+// a start of the middle-out search, the middle state has a single active
+// S-box with the given mask
+struct MiddlePattern {
+  unsigned int box;
+  BitVector value;
+  double bound;  // upper bound on the bias of its characteristics
+};
+
+// the single box patterns of one state, ordered by the best bias they allow
+struct MiddleCatalogue {
+  MiddleCatalogue(Permutation* perm, unsigned int state);
+  bool Supported() const;
+  void Build(Permutation* start, bool canonical);
+  bool Seed(Permutation* start, const MiddlePattern& pattern,
+            std::unique_ptr<Permutation>& result) const;
+  void Split(const Settings& settings, Settings& backward,
+             Settings& forward) const;
+
+  std::vector<MiddlePattern> patterns_;
+
+ private:
+  bool Fix(Permutation* perm, unsigned int box, BitVector value,
+           bool other_boxes) const;
+
+  unsigned int state_;
+  int layer_;           // S-box layer next to the state, -1 if there is none
+  unsigned int split_;  // S-box layers before split_ are guessed backward
+};
+
+#endif /* MIDDLEOUT_H_ */
@@ -0,0 +1,268 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "minactive.h"
+
+#include <algorithm>
+
+MinimumActive::MinimumActive(TruncatedModel& model, Permutation* perm,
+                             std::ostream& out)
+    : model_(model),
+      anchors_(model.getNumLayers()),
+      bounds_(model.getNumLayers(),
+              std::vector<unsigned int>(model.getNumLayers(), 0)),
+      nodes_(0),
+      stopped_(false),
+      out_(&out) {
+  // the activity of the linear layers is the same for all rotations, so a
+  // rotation invariant characteristic can be rotated to an active box at bit
+  // 0 of the first layer of a window
+  if (perm->RotationalSymmetry() > 1)
+    for (unsigned int layer = 0; layer < anchors_.size(); ++layer)
+      anchors_[layer] = perm->anchorBoxes(layer);
+  for (unsigned int layer = 0; layer < bounds_.size(); ++layer)
+    bounds_[layer][layer] = 1;
+}
+
+bool MinimumActive::ComputeBounds(Permutation* start,
+                                  unsigned int max_active,
+                                  SearchBudget& budget) {
+  // dynamic programming over the windows of S-box layers, from short windows
+  // to the ones just shorter than the permutation, the two layer windows give
+  // the branch number of a linear layer on the level of S-boxes, the bit level
+  // propagation still covers all layers
+  unsigned int layers = model_.getNumLayers();
+  for (unsigned int length = 2; length < layers; ++length)
+    for (unsigned int first = 0; first + length <= layers; ++first) {
+      unsigned int last = first + length - 1;
+
+      ActivityPattern pattern;
+      std::unique_ptr<Permutation> perm = start->clone(), result;
+      model_.InitPattern(perm.get(), pattern);
+      Order(pattern, perm.get(), first, last);
+      unsigned int minimum;
+      model_.Restrict(first, last);
+      bool found = Deepen(first, last, SplitBound(first, last), max_active, perm.get(), budget,
+                          minimum, pattern, result);
+      model_.Restrict(0, layers - 1);
+      bounds_[first][last] = minimum;
+      if (found == false)
+        return false;
+    }
+  return true;
+}
+
+unsigned int MinimumActive::Bound(unsigned int first,
+                                  unsigned int last) const {
+  return bounds_[first][last];
+}
+
+bool MinimumActive::Search(Permutation* start, unsigned int max_active,
+                           SearchBudget& budget, unsigned int& minimum,
+                           ActivityPattern& pattern,
+                           std::unique_ptr<Permutation>& result) {
+  unsigned int last = model_.getNumLayers() - 1;
+  std::unique_ptr<Permutation> perm = start->clone();
+  model_.InitPattern(perm.get(), pattern);
+  Order(pattern, perm.get(), 0, last);
+  bool found = Deepen(0, last, SplitBound(0, last), max_active, perm.get(),
+                      budget, minimum, pattern, result);
+  bounds_[0][last] = minimum;
+  return found;
+}
+
+unsigned long long MinimumActive::getNodes() const {
+  return nodes_;
+}
+
+bool MinimumActive::Stopped() const {
+  return stopped_;
+}
+
+unsigned int MinimumActive::SplitBound(unsigned int first,
+                                       unsigned int last) const {
+  unsigned int lower = 0;
+  for (unsigned int split = first; split < last; ++split)
+    lower = std::max(lower, bounds_[first][split] + bounds_[split + 1][last]);
+  return lower;
+}
+
+bool MinimumActive::Deepen(unsigned int first, unsigned int last,
+                           unsigned int start, unsigned int max_active,
+                           Permutation* perm, SearchBudget& budget,
+                           unsigned int& minimum, ActivityPattern& pattern,
+                           std::unique_ptr<Permutation>& result) {
+  // iterative deepening, the first number of active boxes which allows a
+  // pattern is the minimum, a stopped search only proves a lower bound
+  unsigned int limit = model_.getLayerEnd(last) - model_.getLayerBegin(first);
+  if (max_active != 0)
+    limit = std::min(limit, max_active);
+  for (minimum = std::max(start, 1U); minimum <= limit; ++minimum) {
+    ActivityPattern current = pattern;
+    std::unique_ptr<Permutation> current_perm = perm->clone();
+    if (Descend(current, current_perm.get(), first, last, minimum, budget, 0)) {
+      pattern = current;
+      result = std::move(current_perm);
+      return true;
+    }
+    if (stopped_)
+      return false;
+    *out_ << "PRINT-INFO: S-box layers " << first << " to " << last
+              << " have more than " << minimum << " active S-boxes, nodes: "
+              << nodes_ << std::endl;
+  }
+  return false;
+}
+
+bool MinimumActive::Descend(ActivityPattern& pattern, Permutation* perm,
+                            unsigned int first, unsigned int last,
+                            unsigned int max_active, SearchBudget& budget,
+                            unsigned int depth) {
+  nodes_++;
+  if (budget.Terminate())
+    stopped_ = true;
+  if (stopped_ || Propagate(pattern, perm, max_active) == false
+      || LowerBound(pattern, first, last) > max_active
+      || Anchored(pattern) == false)
+    return false;
+
+  // the boxes are decided layer by layer, inactive boxes first
+  unsigned int box = model_.getNumBoxes();
+  for (unsigned int layer : order_) {
+    box = model_.getLayerBegin(layer);
+    while (box < model_.getLayerEnd(layer) && pattern[box] != TR_DUNNO)
+      ++box;
+    if (box < model_.getLayerEnd(layer))
+      break;
+    box = model_.getNumBoxes();
+  }
+  if (box == model_.getNumBoxes())
+    return true;
+
+  // every depth reuses its own copy of the characteristic
+  if (scratch_.size() <= depth)
+    scratch_.emplace_back(perm->clone());
+  Permutation* next_perm = scratch_[depth].get();
+  for (int8_t activity : { TR_INACTIVE, TR_ACTIVE }) {
+    ActivityPattern next = pattern;
+    next_perm->copyValues(perm);
+    next[box] = activity;
+    if (Descend(next, next_perm, first, last, max_active, budget,
+                depth + 1)) {
+      pattern = next;
+      perm->copyValues(next_perm);
+      return true;
+    }
+    if (stopped_)
+      return false;
+  }
+  return false;
+}
+
+bool MinimumActive::Propagate(ActivityPattern& pattern, Permutation* perm,
+                              unsigned int max_active) const {
+  ActivityPattern last;
+  while (last != pattern) {
+    last = pattern;
+    if (model_.Propagate(pattern, max_active) == false)
+      return false;
+    if (model_.Apply(pattern, perm) == false)
+      return false;
+  }
+  return true;
+}
+
+void MinimumActive::Order(ActivityPattern& pattern, Permutation* perm,
+                          unsigned int first, unsigned int last) {
+  // the layers are decided from a layer with an active box to both ends, so
+  // the sparse layers next to it bound the dense ones early, without an
+  // active box a rotation invariant characteristic gets one at bit 0
+  int start = -1;
+  for (unsigned int layer = first; layer <= last && start < 0; ++layer)
+    for (unsigned int box = model_.getLayerBegin(layer);
+        box < model_.getLayerEnd(layer); ++box)
+      if (pattern[box] == TR_ACTIVE)
+        start = layer;
+  // a single box at bit 0 is set active, of several ones (keccak) one has to
+  // become active
+  anchored_.clear();
+  if (start < 0) {
+    start = last;
+    if (perm->rotationInvariant())
+      for (unsigned int box : anchors_[start])
+        anchored_.push_back(model_.getLayerBegin(start) + box);
+    if (anchored_.size() == 1) {
+      pattern[anchored_[0]] = TR_ACTIVE;
+      anchored_.clear();
+    }
+  }
+
+  order_.clear();
+  for (int layer = start; layer >= (int) first; --layer)
+    order_.push_back(layer);
+  for (unsigned int layer = start + 1; layer <= last; ++layer)
+    order_.push_back(layer);
+}
+
+bool MinimumActive::Anchored(const ActivityPattern& pattern) const {
+  if (anchored_.empty())
+    return true;
+  for (unsigned int box : anchored_)
+    if (pattern[box] != TR_INACTIVE)
+      return true;
+  return false;
+}
+
+unsigned int MinimumActive::LowerBound(const ActivityPattern& pattern,
+                                       unsigned int first,
+                                       unsigned int last) const {
+  // every layer has at least its known active boxes, and at least one as long
+  // as it is not decided
+  std::vector<unsigned int> known(last + 1, 0);
+  for (unsigned int layer = first; layer <= last; ++layer) {
+    bool decided = true;
+    for (unsigned int box = model_.getLayerBegin(layer);
+        box < model_.getLayerEnd(layer); ++box) {
+      known[layer] += pattern[box] == TR_ACTIVE;
+      decided &= pattern[box] != TR_DUNNO;
+    }
+    if (decided == false)
+      known[layer] = std::max(known[layer], 1U);
+  }
+
+  // the layers are split into windows, each one counts at least as much as
+  // its minimum and its known boxes, the best split is the bound
+  std::vector<unsigned int> best(last + 2, 0);
+  for (unsigned int end = first; end <= last; ++end) {
+    unsigned int counted = 0;
+    for (int begin = end; begin >= (int) first; --begin) {
+      counted += known[begin];
+      unsigned int window = std::max(counted, bounds_[begin][end]);
+      best[end + 1] = std::max(best[end + 1], best[begin] + window);
+    }
+  }
+  return best[last + 1];
+}
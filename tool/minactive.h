@@ -0,0 +1,82 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef MINACTIVE_H_
+#define MINACTIVE_H_
+
+#include <vector>
+#include <memory>
+#include <ostream>
+
+#include "permutation.h"
+#include "truncated.h"
+#include "budget.h"
+
+// finds the minimum number of active S-boxes with a depth-first search over
+// activity patterns, the minima of shorter windows of S-box layers bound the
+// number of active boxes of the layers which are not decided yet
+struct MinimumActive {
+  MinimumActive(TruncatedModel& model, Permutation* perm, std::ostream& out);
+  bool ComputeBounds(Permutation* start, unsigned int max_active,
+                     SearchBudget& budget);
+  unsigned int Bound(unsigned int first, unsigned int last) const;
+  bool Search(Permutation* start, unsigned int max_active,
+              SearchBudget& budget, unsigned int& minimum,
+              ActivityPattern& pattern, std::unique_ptr<Permutation>& result);
+  unsigned long long getNodes() const;
+  bool Stopped() const;
+
+ private:
+  unsigned int SplitBound(unsigned int first, unsigned int last) const;
+  bool Deepen(unsigned int first, unsigned int last, unsigned int start,
+              unsigned int max_active, Permutation* perm, SearchBudget& budget,
+              unsigned int& minimum, ActivityPattern& pattern,
+              std::unique_ptr<Permutation>& result);
+  bool Descend(ActivityPattern& pattern, Permutation* perm,
+               unsigned int first, unsigned int last, unsigned int max_active,
+               SearchBudget& budget, unsigned int depth);
+  bool Propagate(ActivityPattern& pattern, Permutation* perm,
+                 unsigned int max_active) const;
+  void Order(ActivityPattern& pattern, Permutation* perm, unsigned int first,
+             unsigned int last);
+  bool Anchored(const ActivityPattern& pattern) const;
+  unsigned int LowerBound(const ActivityPattern& pattern, unsigned int first,
+                          unsigned int last) const;
+
+  TruncatedModel& model_;
+  // the boxes of each layer at bit 0 and the ones of which one has to be
+  // active in the current search
+  std::vector<std::vector<unsigned int>> anchors_;
+  std::vector<unsigned int> anchored_;
+  std::vector<std::vector<unsigned int>> bounds_;
+  std::vector<unsigned int> order_;  // the layers in the order of decisions
+  std::vector<std::unique_ptr<Permutation>> scratch_;  // one per depth
+  unsigned long long nodes_;
+  bool stopped_;
+  std::ostream* out_;
+};
+
+#endif /* MINACTIVE_H_ */
@@ -0,0 +1,77 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "nogood.h"
+
+Nogood::Nogood(const StateHash& before, unsigned int layer, unsigned int pos)
+    : hash_(before) {
+  hash_.Add(((uint64_t) layer << 32) | pos);
+}
+
+void Nogood::Masks(uint64_t in_care, uint64_t in, uint64_t out_care,
+                   uint64_t out) {
+  hash_.Add(in_care);
+  hash_.Add(in);
+  hash_.Add(out_care);
+  hash_.Add(out);
+}
+
+//-----------------------------------------------------------------------------
+
+NogoodTable::NogoodTable(unsigned int entries)
+    : stored_(0),
+      hits_(0),
+      entries_(entries ? new Entry[entries] : nullptr),
+      size_(entries) {
+  for (unsigned int i = 0; i < size_; ++i) {
+    entries_[i].key_ = 0;
+    entries_[i].check_ = 0;
+  }
+}
+
+bool NogoodTable::Enabled() const {
+  return size_ != 0;
+}
+
+bool NogoodTable::Contains(const Nogood& nogood) {
+  if (Enabled() == false)
+    return false;
+  const Entry& entry = entries_[nogood.hash_.key_ % size_];
+  if (entry.key_.load(std::memory_order_relaxed) != nogood.hash_.key_
+      || entry.check_.load(std::memory_order_relaxed) != nogood.hash_.check_)
+    return false;
+  hits_++;
+  return true;
+}
+
+void NogoodTable::Store(const Nogood& nogood) {
+  if (Enabled() == false)
+    return;
+  Entry& entry = entries_[nogood.hash_.key_ % size_];
+  entry.key_.store(nogood.hash_.key_, std::memory_order_relaxed);
+  entry.check_.store(nogood.hash_.check_, std::memory_order_relaxed);
+  stored_++;
+}
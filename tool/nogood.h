@@ -0,0 +1,70 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef NOGOOD_H_
+#define NOGOOD_H_
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "statehash.h"
+
+// a guess whose update failed, identified by the hash of the characteristic
+// before the guess, the guessed box and the masks the box was given
+struct Nogood {
+  Nogood(const StateHash& before, unsigned int layer, unsigned int pos);
+  void Masks(uint64_t in_care, uint64_t in, uint64_t out_care, uint64_t out);
+
+  StateHash hash_;
+};
+
+// bounded table of the guesses which led to a contradiction, the update of a
+// guess which is found in the table is skipped, an entry is replaced by the
+// next nogood with the same index
+struct NogoodTable {
+  NogoodTable(unsigned int entries);
+  bool Enabled() const;
+  bool Contains(const Nogood& nogood);
+  void Store(const Nogood& nogood);
+
+  std::atomic<unsigned long long> stored_;
+  std::atomic<unsigned long long> hits_;
+
+ private:
+  // the two halves of an entry are written without a lock, a torn entry
+  // matches no nogood
+  struct Entry {
+    std::atomic<uint64_t> key_;
+    std::atomic<uint64_t> check_;
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  unsigned int size_;
+};
+
+#endif /* NOGOOD_H_ */
@@ -25,15 +25,36 @@ OTHER DEALINGS IN THE SOFTWARE.
 For more information, please refer to <http://unlicense.org/>
 */
 #include "permutation.h"
+#include "metrics.h"
+#include "trace.h"
 
 //#define LATEX
 //#define LATEXX 5
 //#define LATEXY 1
 
+// counts a guessed S-box and whether the propagation after it worked
+static bool Guessed(bool update_works) {
+  Metrics::Count(METRIC_GUESSES);
+  if (update_works == false)
+    Metrics::Count(METRIC_FAILED_GUESSES);
+  return update_works;
+}
+
+static uint64_t RotateWord(uint64_t word, unsigned int amount,
+                           unsigned int bits) {
+  if (amount == 0)
+    return word;
+  uint64_t all = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+  return ((word << amount) | (word >> (bits - amount))) & all;
+}
+
 Permutation::Permutation(unsigned int rounds)
     : toupdate_linear(true),
       toupdate_nonlinear(true),
       rounds_(rounds),
+      canonical_(false),
+      statistics_(nullptr),
+      nogoods_(nullptr),
       saved_toupdate_linear(true),
       saved_toupdate_nonlinear(true){
   state_masks_.resize(2 * rounds_ + 1);
@@ -46,6 +67,7 @@ Permutation::Permutation(unsigned int rounds)
 
 Permutation::Permutation(const Permutation& other)
     : Permutation(other.rounds_) {
+  TRACE_SCOPE("Permutation::clone");
   for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
     this->state_masks_[i].reset(other.state_masks_[i]->clone());
   }
@@ -60,9 +82,15 @@ Permutation::Permutation(const Permutation& other)
   }
   this->toupdate_linear = other.toupdate_linear;
   this->toupdate_nonlinear = other.toupdate_nonlinear;
+  this->canonical_ = other.canonical_;
+  this->statistics_ = other.statistics_;
+  this->nogoods_ = other.nogoods_;
+  this->decisions_ = other.decisions_;
+  Metrics::Count(METRIC_CLONES);
 }
 
 void Permutation::save() {
+  TRACE_SCOPE("Permutation::save");
   for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
     saved_state_masks_[i]->copyValues(state_masks_[i].get());
   }
@@ -74,9 +102,12 @@ void Permutation::save() {
 
   saved_toupdate_linear = toupdate_linear;
   saved_toupdate_nonlinear = toupdate_nonlinear;
+  saved_decisions_ = decisions_;
+  Metrics::Count(METRIC_SAVES);
 }
 
 void Permutation::restore() {
+  TRACE_SCOPE("Permutation::restore");
   for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
     state_masks_[i]->copyValues(saved_state_masks_[i].get());
   }
@@ -87,6 +118,8 @@ void Permutation::restore() {
   }
   toupdate_linear = saved_toupdate_linear;
   toupdate_nonlinear = saved_toupdate_nonlinear;
+  decisions_ = saved_decisions_;
+  Metrics::Count(METRIC_RESTORES);
 }
 
 void Permutation::SboxStatus(std::vector<SboxPos>& active,
@@ -135,7 +168,7 @@ bool Permutation::guessbestsbox(SboxPos pos,
                                            rating);
 
   this->toupdate_linear = true;
-  return update();
+  return Guessed(update());
 }
 
 bool Permutation::guessbestsbox(SboxPos pos,
@@ -151,7 +184,7 @@ bool Permutation::guessbestsbox(SboxPos pos,
         total_alternatives < num_alternatives ?
             total_alternatives : num_alternatives;
     this->toupdate_linear = true;
-    update_works = update();
+    update_works = Guessed(update());
     if (update_works)
       return update_works;
     this->set(temp.get());
@@ -164,6 +197,25 @@ bool Permutation::guessbestsboxrandom(SboxPos pos,
                                       int num_alternatives) {
   bool update_works = false;
 
+  // with statistics, the masks are also rated by how they did before for the
+  // same pattern of the box
+  std::unique_ptr<StatisticsOrdering> ordering;
+  unsigned long long pattern = 0;
+  if (statistics_ != nullptr) {
+    SboxLayerBase* layer = this->sbox_layers_[pos.layer_].get();
+    pattern = GuessStatistics::Pattern(
+        layer->GetVerticalMask(pos.pos_, *layer->in),
+        layer->GetVerticalMask(pos.pos_, *layer->out));
+    ordering.reset(new StatisticsOrdering(statistics_, pos.layer_, pattern));
+  }
+
+  // the nogoods are keyed by the unrotated characteristic before the guess,
+  // which restore() brings back for every alternative
+  bool nogoods = nogoods_ != nullptr && nogoods_->Enabled();
+  StateHash before;
+  if (nogoods)
+    before = hash(0);
+
   save();
   for (int i = 0; i < num_alternatives; ++i) {
     int total_alternatives = 0xffff;
@@ -174,15 +226,59 @@ bool Permutation::guessbestsboxrandom(SboxPos pos,
     num_alternatives =
         total_alternatives < num_alternatives ?
             total_alternatives : num_alternatives;
+    unsigned int in = 0, out = 0;
+    Nogood nogood(before, pos.layer_, pos.pos_);
+    if (statistics_ != nullptr || nogoods) {
+      SboxLayerBase* layer = this->sbox_layers_[pos.layer_].get();
+      WordMaskCare in_mask =
+          layer->GetVerticalMask(pos.pos_, *layer->in).caremask;
+      WordMaskCare out_mask =
+          layer->GetVerticalMask(pos.pos_, *layer->out).caremask;
+      in = in_mask.canbe1 & in_mask.care;
+      out = out_mask.canbe1 & out_mask.care;
+      nogood.Masks(in_mask.care, in, out_mask.care, out);
+    }
+    // a guess which failed before from the same characteristic fails again
+    if (nogoods && nogoods_->Contains(nogood)) {
+      Metrics::Count(METRIC_NOGOOD_HITS);
+      Guessed(false);
+      if (statistics_ != nullptr)
+        ordering->Failure(in, out);
+      restore();
+      continue;
+    }
     this->toupdate_linear = true;
-    update_works = update();
-    if (update_works)
+    update_works = Guessed(update());
+    if (update_works) {
+      if (GuessTrace::Current() != nullptr)
+        GuessTrace::Current()->Alternative(i);
+      if (statistics_ != nullptr)
+        decisions_ = std::make_shared<const GuessDecision>(GuessDecision {
+            pos.layer_, pattern, in, out, decisions_ });
       return update_works;
+    }
+    if (statistics_ != nullptr)
+      ordering->Failure(in, out);
+    if (nogoods)
+      nogoods_->Store(nogood);
     restore();
   }
+  if (GuessTrace::Current() != nullptr)
+    GuessTrace::Current()->Alternative(num_alternatives);
   return false;
 }
 
+bool Permutation::guessalternativesbox(SboxPos pos,
+                                       std::function<int(int, int, int)> rating,
+                                       int alternative,
+                                       int& total_alternatives) {
+  total_alternatives = this->sbox_layers_[pos.layer_]->GuessBox(pos.pos_,
+                                                                rating,
+                                                                alternative);
+  this->toupdate_linear = true;
+  return Guessed(update());
+}
+
 void Permutation::set(Permutation* perm) {
   for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
     this->state_masks_[i].reset(perm->state_masks_[i]->clone());
@@ -200,18 +296,178 @@ void Permutation::set(Permutation* perm) {
   this->toupdate_nonlinear = perm->toupdate_nonlinear;
 }
 
+void Permutation::copyValues(Permutation* perm) {
+  for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i)
+    state_masks_[i]->copyValues(perm->state_masks_[i].get());
+
+  for (unsigned int i = 0; i < rounds_; ++i) {
+    sbox_layers_[i]->copyValues(perm->sbox_layers_[i].get());
+    linear_layers_[i]->copyValues(perm->linear_layers_[i].get());
+  }
+  toupdate_linear = perm->toupdate_linear;
+  toupdate_nonlinear = perm->toupdate_nonlinear;
+  decisions_ = perm->decisions_;
+}
+
+StateHash Permutation::hash() {
+  // with canonical_ set, all rotated copies of a characteristic are hashed
+  // in the same rotation
+  return hash(canonical_ ? canonicalRotation() : 0);
+}
+
+StateHash Permutation::hash(unsigned int rotation) {
+  unsigned int symmetry = RotationalSymmetry();
+  StateHash hash;
+
+  // only the fixed bits count, canbe1 of undetermined bits is ignored
+  for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
+    unsigned int bits = state_masks_[i]->getnumbits();
+    unsigned int amount = rotation * (bits / symmetry);
+    for (unsigned int w = 0; w < state_masks_[i]->getnumwords(); ++w) {
+      const WordMaskCare& mask = (*state_masks_[i])[w].caremask;
+      hash.Add(RotateWord(mask.care, amount, bits));
+      hash.Add(RotateWord(mask.canbe1 & mask.care, amount, bits));
+    }
+  }
+  return hash;
+}
+
+unsigned int Permutation::canonicalRotation() {
+  // the rotation under which the fixed bits of all words are the smallest in
+  // lexicographic order, the candidates are narrowed word by word so that
+  // usually the first nonzero word decides
+  unsigned int symmetry = RotationalSymmetry();
+  std::vector<unsigned int> candidates, kept;
+  for (unsigned int r = 0; r < symmetry; ++r)
+    candidates.push_back(r);
+
+  for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i) {
+    unsigned int bits = state_masks_[i]->getnumbits();
+    unsigned int step = bits / symmetry;
+    for (unsigned int w = 0; w < state_masks_[i]->getnumwords(); ++w) {
+      const WordMaskCare& mask = (*state_masks_[i])[w].caremask;
+      for (uint64_t plane : { mask.care, mask.canbe1 & mask.care }) {
+        if (candidates.size() == 1)
+          return candidates[0];
+        uint64_t smallest = ~0ULL;
+        kept.clear();
+        for (unsigned int r : candidates) {
+          uint64_t rotated = RotateWord(plane, r * step, bits);
+          if (rotated < smallest) {
+            smallest = rotated;
+            kept.clear();
+          }
+          if (rotated == smallest)
+            kept.push_back(r);
+        }
+        candidates.swap(kept);
+      }
+    }
+  }
+  // the characteristic is the same in all remaining rotations
+  return candidates[0];
+}
+
+void Permutation::GetPlanes(MaskPlanes& planes) {
+  planes.clear();
+  for (auto& state : state_masks_)
+    for (unsigned int w = 0; w < state->getnumwords(); ++w)
+      planes.emplace_back((*state)[w].caremask.canbe1,
+                          (*state)[w].caremask.care);
+}
+
+bool Permutation::SetPlanes(const MaskPlanes& planes) {
+  // the linear layers keep what they learned, so the planes should be set on
+  // a copy which is not more constrained than them
+  unsigned int i = 0;
+  for (auto& state : state_masks_)
+    for (unsigned int w = 0; w < state->getnumwords(); ++w, ++i) {
+      if (i >= planes.size())
+        return false;
+      (*state)[w].caremask.canbe1 = planes[i].first;
+      (*state)[w].caremask.care = planes[i].second;
+      (*state)[w].reinit_bitmasks();
+    }
+  touchall();
+  return update();
+}
+
+unsigned int Permutation::RotationalSymmetry() {
+  return 1;
+}
+
+bool Permutation::anchorRotation() {
+  // the first S-box layer of a nonzero characteristic has an active box,
+  // which can be rotated to bit position 0, a single box there is set active
+  // while several ones (keccak) cannot be required on bit level
+  if (rotationInvariant() == false)
+    return false;
+  std::vector<unsigned int> anchors = anchorBoxes(0);
+  if (anchors.size() != 1)
+    return false;
+  sbox_layers_[0]->SetSboxActive(anchors[0], true);
+  touchall();
+  return true;
+}
+
+bool Permutation::rotationInvariant() {
+  unsigned int symmetry = RotationalSymmetry();
+  if (symmetry == 1)
+    return false;
+
+  // only a characteristic which is the same for all rotations can be rotated
+  // freely
+  for (unsigned int i = 0; i < 2 * rounds_ + 1; ++i)
+    for (unsigned int w = 0; w < state_masks_[i]->getnumwords(); ++w) {
+      const WordMaskCare& mask = (*state_masks_[i])[w].caremask;
+      unsigned int bits = state_masks_[i]->getnumbits();
+      unsigned int step = bits / symmetry;
+      if (RotateWord(mask.care, step, bits) != mask.care
+          || RotateWord(mask.canbe1, step, bits) != mask.canbe1)
+        return false;
+    }
+  return true;
+}
+
+std::vector<unsigned int> Permutation::anchorBoxes(unsigned int sbox_layer) {
+  // the boxes of the layer which cover bit position 0 of some word, one for
+  // ascon and the five rows of slice 0 for keccak
+  SboxLayerBase* layer = sbox_layers_[sbox_layer].get();
+  std::unique_ptr<StateMaskBase> scratch(layer->in->clone());
+  std::vector<unsigned int> anchors;
+  for (unsigned int box = 0; box < layer->GetNumSteps(); ++box) {
+    scratch->SetState(BM_0);
+    Mask mask = layer->GetVerticalMask(box, *scratch);
+    for (unsigned int b = 0; b < mask.bitmasks.size(); ++b)
+      mask.set_bit(BM_1, b);
+    layer->SetVerticalMask(box, *scratch, mask);
+    for (unsigned int w = 0; w < scratch->getnumwords(); ++w)
+      if ((*scratch)[w].bitmasks[0] == BM_1) {
+        anchors.push_back(box);
+        break;
+      }
+  }
+  return anchors;
+}
+
 bool Permutation::update() {
+  TRACE_SCOPE("Permutation::update");
   //TODO: Faster update still under test
   std::unique_ptr<StateMaskBase> tempin, tempout;
   bool update_before, update_after;
+  Metrics::Count(METRIC_PROPAGATIONS);
   while (this->toupdate_linear == true || this->toupdate_nonlinear == true) {
+    Metrics::Count(METRIC_SWEEPS);
     if (this->toupdate_nonlinear == true) {
       this->toupdate_nonlinear = false;
       for (unsigned int layer = 0; layer < rounds_; ++layer) {
+        Metrics::Count(METRIC_SBOX_UPDATES);
         tempin.reset(this->sbox_layers_[layer]->in->clone());
         tempout.reset(this->sbox_layers_[layer]->out->clone());
-        if (this->sbox_layers_[layer]->Update() == false)
+        if (this->sbox_layers_[layer]->Update() == false) {
+          Metrics::Contradiction(layer, false);
           return false;
+        }
         update_before = this->sbox_layers_[layer]->in->diffLinear(*(tempin));
         update_after = this->sbox_layers_[layer]->out->diffLinear(*(tempout));
 //        update_before = this->sbox_layers_[layer]->in->changesforLinear();
@@ -223,10 +479,13 @@ bool Permutation::update() {
     if (this->toupdate_linear == true) {
       this->toupdate_linear = false;
       for (unsigned int layer = 0; layer < rounds_; ++layer) {
+        Metrics::Count(METRIC_LINEAR_UPDATES);
         tempin.reset(this->linear_layers_[layer]->in->clone());
         tempout.reset(this->linear_layers_[layer]->out->clone());
-        if (this->linear_layers_[layer]->Update() == false)
+        if (this->linear_layers_[layer]->Update() == false) {
+          Metrics::Contradiction(layer, true);
           return false;
+        }
         update_before = this->linear_layers_[layer]->in->diffSbox(*(tempin));
         update_after = this->linear_layers_[layer]->out->diffSbox(*(tempout));
 //        update_before = this->linear_layers_[layer]->in->changesforSbox();
@@ -253,6 +512,27 @@ double Permutation::GetProbability() {
   return prob;
 }
 
+double Permutation::GetCorrelation() {
+  double correlation = 1.0;
+
+  // the linear layers have correlation 1, constants are not modelled
+  for (auto& layer : this->sbox_layers_)
+    correlation *= layer->GetCorrelation();
+
+  return correlation;
+}
+
+double Permutation::GetProbabilityBound() {
+  double prob = 0.0;
+
+  for (auto& layer : this->sbox_layers_)
+    prob += layer->GetProbabilityBound();
+
+  prob += rounds_ - 1;
+
+  return prob;
+}
+
 unsigned int Permutation::GetActiveSboxes() {
   unsigned int active_sboxes_layer = 0;
 
@@ -415,3 +695,20 @@ bool Permutation::setBox(bool active, unsigned int box_num) {
   return true;
 }
 
+
+bool Permutation::setBoxInactive(SboxPos pos) {
+  SboxLayerBase* layer = sbox_layers_[pos.layer_].get();
+  Mask in(layer->GetVerticalMask(pos.pos_, *layer->in));
+  Mask out(layer->GetVerticalMask(pos.pos_, *layer->out));
+
+  for (unsigned int i = 0; i < in.bitmasks.size(); ++i) {
+    if (in.bitmasks[i] == BM_1 || out.bitmasks[i] == BM_1)
+      return false;
+    in.set_bit(BM_0, i);
+    out.set_bit(BM_0, i);
+  }
+  layer->SetVerticalMask(pos.pos_, *layer->in, in);
+  layer->SetVerticalMask(pos.pos_, *layer->out, out);
+  touchall();
+  return true;
+}
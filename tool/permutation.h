@@ -31,9 +31,15 @@ For more information, please refer to <http://unlicense.org/>
 #include <memory>
 
 #include "layer.h"
+#include "statehash.h"
+#include "guessstatistics.h"
+#include "nogood.h"
 #include "statemask.h"
 
 
+// the canbe1 and care words of all states, one state after the other
+typedef std::vector<std::pair<BitVector, BitVector>> MaskPlanes;
+
 struct Permutation {
   typedef std::unique_ptr<Permutation> PermPtr;
   Permutation(unsigned int rounds);
@@ -44,6 +50,8 @@ struct Permutation {
   virtual void print(std::ostream& stream);
   virtual PermPtr clone() const = 0;
   virtual void set(Permutation* perm);
+  // like set, but without allocating, perm has to be of the same kind
+  void copyValues(Permutation* perm);
   virtual void save();
   virtual void restore();
   virtual void SboxStatus(std::vector<SboxPos>& active, std::vector<SboxPos>& inactive);
@@ -52,13 +60,28 @@ struct Permutation {
   virtual bool guessbestsbox(SboxPos pos, std::function<int(int, int, int)> rating);
   virtual bool guessbestsboxrandom(SboxPos pos, std::function<int(int, int, int)> rating, int num_alternatives);
   virtual bool guessbestsbox(SboxPos pos, std::function<int(int, int, int)> rating, int num_alternatives);
+  virtual bool guessalternativesbox(SboxPos pos, std::function<int(int, int, int)> rating, int alternative, int& total_alternatives);
   virtual void PrintWithProbability(std::ostream& stream = std::cout, unsigned int offset = 0);
   virtual void touchall();
   virtual double GetProbability();
+  virtual double GetCorrelation();
+  virtual double GetProbabilityBound();
   virtual unsigned int GetActiveSboxes();
   virtual bool setBit(BitMask cond, unsigned int bit);
   bool setBit(const char cond, unsigned int bit, unsigned char num_words, unsigned char num_bits);
   virtual bool setBox(bool active, unsigned int box_num);
+  virtual bool setBoxInactive(SboxPos pos);
+  virtual StateHash hash();
+  // hash of the fixed bits with all words rotated by rotation steps
+  StateHash hash(unsigned int rotation);
+  void GetPlanes(MaskPlanes& planes);
+  bool SetPlanes(const MaskPlanes& planes);
+  // number of rotations of all words by the same amount which keep the bias
+  virtual unsigned int RotationalSymmetry();
+  unsigned int canonicalRotation();
+  bool anchorRotation();
+  bool rotationInvariant();
+  std::vector<unsigned int> anchorBoxes(unsigned int sbox_layer);
 
   std::vector<std::unique_ptr<StateMaskBase>> state_masks_;
   std::vector<std::unique_ptr<SboxLayerBase>> sbox_layers_;
@@ -66,12 +89,17 @@ struct Permutation {
   bool toupdate_linear;
   bool toupdate_nonlinear;
   unsigned int rounds_;
+  bool canonical_;
+  GuessStatistics* statistics_;
+  NogoodTable* nogoods_;
+  std::shared_ptr<const GuessDecision> decisions_;
 
   std::vector<std::unique_ptr<StateMaskBase>> saved_state_masks_;
   std::vector<std::unique_ptr<SboxLayerBase>> saved_sbox_layers_;
   std::vector<std::unique_ptr<LinearLayer>> saved_linear_layers_;
   bool saved_toupdate_linear;
   bool saved_toupdate_nonlinear;
+  std::shared_ptr<const GuessDecision> saved_decisions_;
 };
 
 
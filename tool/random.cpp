@@ -0,0 +1,111 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include "random.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+uint64_t SplitMix64(uint64_t& x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// the seed of a stream, neighbouring streams get unrelated seeds, the streams
+// of the threads and those chosen by UseStream never meet
+uint64_t StreamSeed(uint64_t seed, uint64_t stream, bool chosen) {
+  uint64_t mixed = 2 * stream + chosen;
+  return seed ^ SplitMix64(mixed);
+}
+
+std::atomic<uint64_t> run_seed(
+    std::chrono::high_resolution_clock::now().time_since_epoch().count());
+// a new seed makes every thread derive its stream again
+std::atomic<unsigned int> generation(0);
+
+struct ThreadGenerator {
+  Xoshiro256 generator_;
+  unsigned int generation_ = 0;
+};
+
+thread_local ThreadGenerator thread_generator;
+
+}  // namespace
+
+Xoshiro256::Xoshiro256(uint64_t seed) {
+  this->seed(seed);
+}
+
+void Xoshiro256::seed(uint64_t seed) {
+  // splitmix64 spreads any seed, even 0, over the whole state
+  for (auto& word : state_)
+    word = SplitMix64(seed);
+}
+
+std::ostream& operator<<(std::ostream& stream, const Xoshiro256& generator) {
+  return stream << generator.state_[0] << " " << generator.state_[1] << " "
+                << generator.state_[2] << " " << generator.state_[3];
+}
+
+std::istream& operator>>(std::istream& stream, Xoshiro256& generator) {
+  return stream >> generator.state_[0] >> generator.state_[1]
+                >> generator.state_[2] >> generator.state_[3];
+}
+
+void Random::Seed(uint64_t seed) {
+  run_seed = seed;
+  ++generation;
+}
+
+uint64_t Random::GetSeed() {
+  return run_seed;
+}
+
+Xoshiro256& Random::Generator() {
+  ThreadGenerator& local = thread_generator;
+  unsigned int current = generation.load(std::memory_order_relaxed) + 1;
+  // a thread without an index draws from the stream of the main thread
+  if (local.generation_ != current)
+    UseThread(0);
+  return local.generator_;
+}
+
+void Random::UseThread(unsigned int thread) {
+  ThreadGenerator& local = thread_generator;
+  local.generator_.seed(StreamSeed(run_seed, thread, false));
+  local.generation_ = generation.load(std::memory_order_relaxed) + 1;
+}
+
+void Random::UseStream(uint64_t stream) {
+  ThreadGenerator& local = thread_generator;
+  local.generator_.seed(StreamSeed(run_seed, stream, true));
+  local.generation_ = generation.load(std::memory_order_relaxed) + 1;
+}
@@ -0,0 +1,78 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+// xoshiro256** by Blackman and Vigna, it is a UniformRandomBitGenerator, so it
+// works with the distributions of <random> and std::shuffle
+struct Xoshiro256 {
+  typedef uint64_t result_type;
+
+  Xoshiro256(uint64_t seed = 0);
+  void seed(uint64_t seed);
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  result_type operator()();
+
+  uint64_t state_[4];
+};
+
+std::ostream& operator<<(std::ostream& stream, const Xoshiro256& generator);
+std::istream& operator>>(std::istream& stream, Xoshiro256& generator);
+
+// all randomness of the tool comes from here, every thread draws from its own
+// stream, which is derived from the seed of the run and the index UseThread
+// gives a thread when it is spawned, the main thread has index 0, or set by
+// UseStream for work which is handed out to threads, so a run repeats for
+// the same seed
+struct Random {
+  static void Seed(uint64_t seed);
+  static uint64_t GetSeed();
+  static Xoshiro256& Generator();
+  static void UseThread(unsigned int thread);
+  static void UseStream(uint64_t stream);
+};
+
+inline Xoshiro256::result_type Xoshiro256::operator()() {
+  uint64_t result = state_[1] * 5;
+  result = ((result << 7) | (result >> 57)) * 9;
+  uint64_t t = state_[1] << 17;
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+  state_[2] ^= t;
+  state_[3] = (state_[3] << 45) | (state_[3] >> 19);
+  return result;
+}
+
+#endif /* RANDOM_H_ */
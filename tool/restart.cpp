@@ -0,0 +1,99 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "restart.h"
+
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+RestartPolicy::RestartPolicy(const std::string& policy, unsigned int credits,
+                             float factor)
+    : policy_(policy),
+      credits_(credits),
+      factor_(factor),
+      restart_(0),
+      current_(credits),
+      rate_(-1) {
+}
+
+bool RestartPolicy::Known(const std::string& policy) {
+  return policy == "fixed" || policy == "luby" || policy == "geometric"
+      || policy == "adaptive";
+}
+
+unsigned int RestartPolicy::getCredits() {
+  double credits = credits_;
+
+  if (policy_ == "luby")
+    credits = (double) credits_ * Luby(restart_ + 1);
+  else if (policy_ == "geometric")
+    credits = credits_ * std::pow(factor_, restart_);
+  else if (policy_ == "adaptive")
+    credits = current_;
+  restart_++;
+
+  return (unsigned int) std::max(1.0, std::min(credits, 2147483648.0));
+}
+
+void RestartPolicy::Finished(unsigned int contradictions,
+                             unsigned int guesses) {
+  if (policy_ != "adaptive" || guesses == 0)
+    return;
+
+  // a restart running into more contradictions than the average is
+  // thrashing, so the next one is shorter, otherwise it gets more credits
+  double rate = (double) contradictions / guesses;
+  if (rate_ < 0)
+    rate_ = rate;
+  if (rate > rate_)
+    current_ /= factor_;
+  else
+    current_ *= factor_;
+  current_ = std::max(current_, credits_ / 64.0);
+  current_ = std::min(current_, credits_ * 64.0);
+  rate_ = 0.9 * rate_ + 0.1 * rate;
+}
+
+void RestartPolicy::Read(std::istream& stream) {
+  stream >> restart_ >> current_ >> rate_;
+}
+
+void RestartPolicy::Write(std::ostream& stream) const {
+  // all digits, so a resumed search gets the same credits
+  stream << restart_ << " " << std::setprecision(17) << current_ << " "
+         << rate_;
+}
+
+unsigned int RestartPolicy::Luby(unsigned int i) {
+  // 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+  unsigned long long k = 1;
+  while ((1ULL << k) - 1 < i)
+    ++k;
+  if ((1ULL << k) - 1 == i)
+    return 1ULL << (k - 1);
+  return Luby(i - (1ULL << (k - 1)) + 1);
+}
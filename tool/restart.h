@@ -0,0 +1,53 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef RESTART_H_
+#define RESTART_H_
+
+#include <string>
+#include <iostream>
+
+// determines the credits of each restart of a search
+struct RestartPolicy {
+  RestartPolicy(const std::string& policy, unsigned int credits, float factor);
+  static bool Known(const std::string& policy);
+  unsigned int getCredits();
+  void Finished(unsigned int contradictions, unsigned int guesses);
+  void Read(std::istream& stream);
+  void Write(std::ostream& stream) const;
+
+ private:
+  static unsigned int Luby(unsigned int i);
+
+  std::string policy_;
+  unsigned int credits_;
+  float factor_;
+  unsigned int restart_;
+  double current_;
+  double rate_;
+};
+
+#endif /* RESTART_H_ */
@@ -28,15 +28,49 @@ For more information, please refer to <http://unlicense.org/>
 
 
 Search::Search(Permutation &perm)
-    : perm_(&perm) {
+    : perm_(&perm),
+      out_(&std::cout),
+      best_bias_(-DBL_MAX) {
 
 }
 
+void Search::setOutput(std::ostream& out) {
+  out_ = &out;
+}
+
 
 void Search::StackSearch1(Commandlineparser& cl_param,
                           Configparser& config_param) {
+  auto rate = [&config_param] (Permutation* perm) {
+    if (config_param.printActive())
+      return -(double) perm->GetActiveSboxes();
+    return perm->GetProbability();
+  };
+  auto label = [] (unsigned int restart, double bias) {
+    return "iteration: " + std::to_string(restart);
+  };
+  StackSearch(cl_param, config_param, rate, label);
+}
+
+void Search::StackSearchKeccak(Commandlineparser& cl_param,
+                          Configparser& config_param) {
+  // the last round of a keccak characteristic is not counted
+  auto rate = [this] (Permutation* perm) {
+    return KeccakProb(perm, false);
+  };
+  auto label = [] (unsigned int restart, double bias) {
+    std::ostringstream label;
+    label << "iteration: " << restart << std::endl
+          << "bias without last round: " << bias;
+    return label.str();
+  };
+  StackSearch(cl_param, config_param, rate, label);
+}
+
+void Search::StackSearch(Commandlineparser& cl_param, Configparser& config_param,
+                         std::function<double(Permutation*)> rate,
+                         std::function<std::string(unsigned int, double)> label) {
 
-  std::unique_ptr<Permutation> working_copy;
   std::stack<std::unique_ptr<Permutation>> char_stack;
 
   double best_prob = -DBL_MAX;
@@ -46,41 +80,144 @@ void Search::StackSearch1(Commandlineparser& cl_param,
   bool backtrack;
   bool active;
 
-  working_copy = config_param.getPermutation();
-  if (working_copy->checkchar() == false) {
-    std::cout << "Initial checkchar failed" << std::endl;
+  SearchSetup setup(cl_param, config_param);
+  if (Setup(cl_param, config_param, setup, true) == false)
     return;
-  }
+  std::unique_ptr<Permutation>& working_copy = setup.working_copy_;
+  TopCharacteristics& top = setup.top_;
+  GuessStatistics& statistics = setup.statistics_;
+  SearchBudget& budget = setup.budget_;
   Settings settings = config_param.getSettings();
+  std::vector<Settings> phases = config_param.getPhases();
+  std::vector<float> phase_shares = config_param.getPhaseShares();
+  RestartPolicy restarts(config_param.getRestart(), config_param.getCredits(),
+                         config_param.getRestartFactor());
+  BoxActivity activity(working_copy.get());
+  if (config_param.getCarry() == "weights")
+    guesses.activity_ = &activity;
+  bool carry_partial = config_param.getCarry() == "partial";
+  std::unique_ptr<Permutation> carried;
+  std::unique_ptr<Permutation> best;
 
   auto start_count = std::chrono::system_clock::now();
-  std::mt19937 generator(
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+  Xoshiro256& generator = Random::Generator();
   std::uniform_real_distribution<float> push_stack_rand(0.0, 1.0);
 
   unsigned int interations = (unsigned int) cl_param.getIntParameter("-iter");
   int total_iterations = 0;
   int print_char = cl_param.getIntParameter("-S");
-  for (unsigned int i = 0; i < interations; ++i) {
-    char_stack.emplace(working_copy->clone());
-    char_stack.emplace(working_copy->clone());
+
+  // a resumed search continues in the restart the checkpoint was taken in
+  std::string config = ConfigName(config_param, working_copy->rounds_);
+  SearchCheckpoint checkpoint(cl_param.getParameter("--checkpoint"),
+                              cl_param.getIntParameter("--checkpoint-interval"),
+                              *out_);
+  CheckpointState resumed;
+  std::string resume_file = cl_param.getParameter("--resume");
+  bool resuming = resume_file.empty() == false;
+  if (resuming) {
+    if (Resume(resume_file, config, working_copy.get(), resumed, top,
+               statistics, restarts, activity, generator, budget) == false)
+      return;
+    best_prob = resumed.best_prob_;
+    total_iterations = resumed.total_iterations_;
+    best = std::move(resumed.best_);
+    carried = std::move(resumed.carried_);
+  }
+  std::vector<MaskPlanes> seeds;
+  LoadSeeds(cl_param, config_param, working_copy.get(), seeds);
+  std::unique_ptr<Permutation> seeded;
+  // a replay runs as many restarts as were recorded
+  GuessTrace trace(cl_param.getParameter("--record"),
+                   cl_param.getParameter("--replay"), config);
+  if (trace.Failed())
+    return;
+  // the budget is only checked before a guess, so a stopped search always
+  // saves the restart it was in
+  for (unsigned int i = resuming ? resumed.restart_ : 0;
+      i < interations || trace.Replaying(); ++i) {
+    if (trace.Restart(i) == false)
+      break;
+    // every second restart starts from the carried partial characteristic,
+    // with stored characteristics every restart starts from one of them
+    Permutation* start =
+        (carried.get() != nullptr && i % 2) ? carried.get() : working_copy.get();
     backtrack = false;
+    settings = phases[budget.Phase(phase_shares, i, interations)];
+    unsigned int credits;
+    unsigned int curr_credit;
+    unsigned int restart_guesses = 0;
+    if (resuming) {
+      // the seed, the credits and the generator were drawn before the
+      // checkpoint, so nothing is drawn again
+      seeded = std::move(resumed.start_);
+      start = seeded.get();
+      for (auto& perm : resumed.stack_)
+        char_stack.push(std::move(perm));
+      backtrack = resumed.backtrack_;
+      backtrack_box = resumed.backtrack_box_;
+      credits = resumed.credits_;
+      curr_credit = resumed.curr_credit_;
+      restart_guesses = resumed.restart_guesses_;
+      resuming = false;
+    } else {
+      if (seeds.empty() == false
+          && Unfix(seeds[generator() % seeds.size()], working_copy.get(),
+                   generator, seeded))
+        start = seeded.get();
+      credits = restarts.getCredits();
+      curr_credit = credits;
+      char_stack.emplace(start->clone());
+      char_stack.emplace(start->clone());
+    }
     guesses.createMask(char_stack.top().get(), settings);
-    unsigned int curr_credit = config_param.getCredits();
-    while (guesses.getRandPos(guessed_box, active)) {
+    bool stopped = false;
+    auto save = [&] () {
+      CheckpointState state;
+      state.restart_ = i;
+      state.total_iterations_ = total_iterations;
+      state.best_prob_ = best_prob;
+      state.credits_ = credits;
+      state.curr_credit_ = curr_credit;
+      state.restart_guesses_ = restart_guesses;
+      state.backtrack_ = backtrack;
+      state.backtrack_box_ = backtrack_box;
+      state.start_ = start->clone();
+      if (carried)
+        state.carried_ = carried->clone();
+      SaveCheckpoint(checkpoint, config, state, char_stack, top, statistics,
+                     restarts, activity, generator, best.get());
+    };
+    while (true) {
+      // the state is saved before the next S-box is drawn, so a resumed
+      // search draws the same one
+      if (budget.Terminate()) {
+        stopped = true;
+        save();
+        break;
+      }
+      if (checkpoint.Due())
+        save();
+      if (guesses.getRandPos(guessed_box, active) == false)
+        break;
       total_iterations++;
+      restart_guesses++;
       auto duration = std::chrono::duration_cast<std::chrono::seconds>(
           std::chrono::system_clock::now() - start_count);
       if (cl_param.getIntParameter("-I") > 0
           && duration.count() > cl_param.getIntParameter("-I")) {
-        std::cout << "PRINT-INFO: total iterations: " << total_iterations
+        *out_ << "PRINT-INFO: total iterations: " << total_iterations
                   << ", stack size: " << char_stack.size() << ", credits: "
                   << curr_credit << ", restarts: " << i << std::endl;
         print_char--;
         if (print_char == 0) {
-          char_stack.top()->print(std::cout);
+          char_stack.top()->print(*out_);
+          top.Print(*out_);
           print_char = cl_param.getIntParameter("-S");
         }
+        if (setup.nogoods_.Enabled())
+          *out_ << "PRINT-INFO: nogoods stored: " << setup.nogoods_.stored_
+                    << ", hits: " << setup.nogoods_.hits_ << std::endl;
         start_count = std::chrono::system_clock::now();
       }
 
@@ -89,151 +226,1129 @@ void Search::StackSearch1(Commandlineparser& cl_param,
 
       if (backtrack)
         guessed_box = backtrack_box;
+      else if (trace.Stopped())
+        break;
 
-      unsigned int wbias = guesses.getSboxWeigthProb();
-      unsigned int whamming = guesses.getSboxWeightHamming();
-      //FIXME: get rid of the 10
-      auto rating = [wbias, whamming] (int bias, int hw_in, int hw_out) {
-        return wbias*std::abs(bias) +whamming*((10-hw_in)+(10-hw_out));
-      };
-      if (char_stack.top()->guessbestsboxrandom(
-          guessed_box, rating, guesses.getAlternativeSboxGuesses())) {
-//          std::cout << "worked " << char_stack.size() << std::endl;
-//          char_stack.top()->print(std::cout);
+      auto rating = guesses.getRating();
+      Metrics::Depth(char_stack.size());
+      trace.Guess(guessed_box.layer_, guessed_box.pos_);
+      bool guess_works = char_stack.top()->guessbestsboxrandom(
+          guessed_box, rating, guesses.getAlternativeSboxGuesses());
+      trace.Outcome(guess_works);
+      if (guess_works) {
+//          *out_ << "worked " << char_stack.size() << std::endl;
+//          char_stack.top()->print(*out_);
         backtrack = false;
-        if (push_stack_rand(generator) <= guesses.getPushStackProb())
+        if (trace.Push(push_stack_rand(generator) <= guesses.getPushStackProb()))
           char_stack.emplace(char_stack.top()->clone());
       } else {
-//          std::cout << "failed" << std::endl;
-//          char_stack.top()->print(std::cout);
+//          *out_ << "failed" << std::endl;
+//          char_stack.top()->print(*out_);
         char_stack.pop();
         curr_credit--;
         backtrack = true;
         backtrack_box = guessed_box;
+        activity.Bump(guessed_box);
         if (char_stack.size() == 1)
-          char_stack.emplace(working_copy->clone());
+          char_stack.emplace(start->clone());
       }
       guesses.createMask(char_stack.top().get(), settings);
     }
-    double current_prob;
-    if (config_param.printActive())
-      current_prob = -char_stack.top()->GetActiveSboxes();
-    else
-      current_prob = char_stack.top()->GetProbability();
+    if (stopped)
+      break;
+    restarts.Finished(credits - curr_credit, restart_guesses);
+    activity.Decay();
+    if (statistics.Enabled()) {
+      if (curr_credit > 0)
+        statistics.Success(char_stack.top()->decisions_);
+      statistics.Decay();
+    }
+    double current_prob = rate(char_stack.top().get());
+    if (curr_credit > 0)
+      top.Add(current_prob, char_stack.top().get());
     if (current_prob > best_prob && curr_credit > 0) {
       best_prob = current_prob;
-      std::cout << "iteration: " << i << std::endl;
-      char_stack.top()->PrintWithProbability();
+      best = char_stack.top()->clone();
+      Report(cl_param, config_param, budget, current_prob,
+             char_stack.top().get(), label(i, current_prob));
     }
-    while (char_stack.size())
+    // the partial characteristic halfway down the stack of the best
+    // characteristic is carried to the next restarts
+    unsigned int carry_pos = char_stack.size() / 2;
+    while (char_stack.size()) {
+      if (carry_partial && curr_credit > 0 && current_prob >= best_prob
+          && char_stack.size() == carry_pos + 1)
+        carried = std::move(char_stack.top());
       char_stack.pop();
+    }
   }
+  SaveStatistics(cl_param, config_param, statistics);
+  budget.Report(*out_);
+  trace.Report(*out_);
+  top.Print(*out_);
 }
 
-void Search::StackSearchKeccak(Commandlineparser& cl_param,
-                          Configparser& config_param) {
+void Search::BeamSearch(Commandlineparser& cl_param,
+                        Configparser& config_param) {
 
-  std::unique_ptr<Permutation> working_copy;
-  std::stack<std::unique_ptr<Permutation>> char_stack;
+  typedef std::unique_ptr<Permutation> PermPtr;
+
+  struct Expansion {
+    unsigned int parent;
+    SboxPos box;
+    std::function<int(int, int, int)> rating;
+    unsigned int alternatives;
+  };
+
+  struct Ranked {
+    double score;
+    unsigned int parent;
+    PermPtr perm;
+  };
 
   double best_prob = -DBL_MAX;
-  GuessMask guesses;
-  SboxPos guessed_box(0, 0);
-  SboxPos backtrack_box(0, 0);
-  bool backtrack;
-  bool active;
 
-  working_copy = config_param.getPermutation();
-  if (working_copy->checkchar() == false) {
-    std::cout << "Initial checkchar failed" << std::endl;
+  SearchSetup setup(cl_param, config_param);
+  if (Setup(cl_param, config_param, setup, true) == false)
     return;
-  }
+  std::unique_ptr<Permutation>& working_copy = setup.working_copy_;
+  TopCharacteristics& top = setup.top_;
+  SearchBudget& budget = setup.budget_;
   Settings settings = config_param.getSettings();
+  std::vector<Settings> phases = config_param.getPhases();
+  std::vector<float> phase_shares = config_param.getPhaseShares();
+  unsigned int beam_width = config_param.getBeamWidth();
+  unsigned int num_threads = std::max(1, cl_param.getIntParameter("--threads"));
+  // keccak characteristics are rated without their last round, as by keccak
+  bool keccak = config_param.getPermutationName().compare(0, 6, "keccak") == 0;
+  auto rate = [this, &config_param, keccak] (Permutation* perm) {
+    if (config_param.printActive())
+      return -(double) perm->GetActiveSboxes();
+    if (keccak)
+      return KeccakProb(perm, false);
+    return perm->GetProbability();
+  };
+  auto bound = [this, &config_param, keccak] (Permutation* perm) {
+    if (config_param.printActive())
+      return -(double) perm->GetActiveSboxes();
+    if (keccak)
+      return KeccakProb(perm, true);
+    return perm->GetProbabilityBound();
+  };
 
   auto start_count = std::chrono::system_clock::now();
-  std::mt19937 generator(
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
-  std::uniform_real_distribution<float> push_stack_rand(0.0, 1.0);
 
   unsigned int interations = (unsigned int) cl_param.getIntParameter("-iter");
   int total_iterations = 0;
   int print_char = cl_param.getIntParameter("-S");
-  for (unsigned int i = 0; i < interations; ++i) {
-    char_stack.emplace(working_copy->clone());
-    char_stack.emplace(working_copy->clone());
-    backtrack = false;
-    guesses.createMask(char_stack.top().get(), settings);
-    unsigned int curr_credit = config_param.getCredits();
-    while (guesses.getRandPos(guessed_box, active)) {
-      total_iterations++;
+  for (unsigned int i = 0; i < interations && budget.Terminate() == false;
+      ++i) {
+    std::vector<PermPtr> beam;
+    beam.emplace_back(working_copy->clone());
+    settings = phases[budget.Phase(phase_shares, i, interations)];
+    unsigned int depth = 0;
+
+    while (beam.empty() == false && budget.Terminate() == false) {
+      // every partial characteristic of the beam either is complete or
+      // chooses the box it is expanded on
+      std::vector<Expansion> expansions;
+      for (unsigned int p = 0; p < beam.size(); ++p) {
+        GuessMask guesses;
+        SboxPos guessed_box(0, 0);
+        bool active;
+        if (guesses.createMask(beam[p].get(), settings)
+            && guesses.getRandPos(guessed_box, active)) {
+          expansions.push_back(
+              Expansion { p, guessed_box, guesses.getRating(),
+                  guesses.getAlternativeSboxGuesses() });
+          continue;
+        }
+        double current_prob = rate(beam[p].get());
+        top.Add(current_prob, beam[p].get());
+        if (current_prob > best_prob) {
+          best_prob = current_prob;
+          Report(cl_param, config_param, budget, current_prob, beam[p].get(),
+                 "iteration: " + std::to_string(i) + ", depth: "
+                     + std::to_string(depth));
+        }
+      }
+
+      // expand each partial characteristic with its best alternatives, the
+      // expansions of different parents are propagated in parallel
+      std::vector<std::vector<PermPtr>> children(expansions.size());
+      auto expand = [&beam, &expansions, &children, num_threads] (unsigned int thread) {
+        for (unsigned int e = thread; e < expansions.size(); e += num_threads) {
+          Expansion& exp = expansions[e];
+          // TakeBestBox skips a mask of a box which has to be active, so the
+          // alternatives are enumerated without the flag as in HullSearch and
+          // the inactive one is dropped
+          bool active = beam[exp.parent]->sbox_layers_[exp.box.layer_]->SboxActive(
+              exp.box.pos_);
+          int total_alternatives = 1;
+          for (int alt = 0; alt < (int) exp.alternatives && alt < total_alternatives; ++alt) {
+            PermPtr child = beam[exp.parent]->clone();
+            SboxLayerBase* layer = child->sbox_layers_[exp.box.layer_].get();
+            layer->SetSboxActive(exp.box.pos_, false);
+            if (child->guessalternativesbox(exp.box, exp.rating, alt, total_alternatives) == false)
+              continue;
+            if (active && layer->SboxActive(exp.box.pos_) == false)
+              continue;
+            layer->SetSboxActive(exp.box.pos_, active);
+            children[e].emplace_back(std::move(child));
+          }
+        }
+      };
+      if (num_threads == 1 || expansions.size() < 2) {
+        expand(0);
+      } else {
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < num_threads && t < expansions.size(); ++t)
+          workers.emplace_back([&expand, t] {
+            Random::UseThread(t + 1);
+            expand(t);
+          });
+        for (auto& worker : workers)
+          worker.join();
+      }
+      total_iterations += expansions.size();
+
+      // rank the partial characteristics by the upper bound on the bias of
+      // their completions, which also drops those which cannot beat the best
+      std::vector<Ranked> ranked;
+      std::set<std::pair<uint64_t, uint64_t>> seen;
+      for (unsigned int e = 0; e < children.size(); ++e) {
+        for (auto& child : children[e]) {
+          // different parents often reach the same partial characteristic
+          StateHash hash = child->hash();
+          if (seen.insert(std::make_pair(hash.key_, hash.check_)).second == false)
+            continue;
+          double score = bound(child.get());
+          if (score < best_prob)
+            continue;
+          ranked.push_back(Ranked { score, expansions[e].parent, std::move(child) });
+        }
+      }
+      std::stable_sort(ranked.begin(), ranked.end(),
+                       [] (const Ranked& a, const Ranked& b) {
+                         return a.score > b.score;
+                       });
+
+      // the best child of every parent is kept first, so that the beam does
+      // not collapse into the descendants of a single partial characteristic,
+      // the remaining places go to the best of the other children
+      std::vector<bool> continued(beam.size(), false);
+      beam.clear();
+      for (auto& entry : ranked)
+        if (beam.size() < beam_width && continued[entry.parent] == false) {
+          continued[entry.parent] = true;
+          beam.emplace_back(std::move(entry.perm));
+        }
+      for (auto& entry : ranked)
+        if (beam.size() < beam_width && entry.perm.get() != nullptr)
+          beam.emplace_back(std::move(entry.perm));
+      depth++;
+
       auto duration = std::chrono::duration_cast<std::chrono::seconds>(
           std::chrono::system_clock::now() - start_count);
       if (cl_param.getIntParameter("-I") > 0
           && duration.count() > cl_param.getIntParameter("-I")) {
-        std::cout << "PRINT-INFO: total iterations: " << total_iterations
-                  << ", stack size: " << char_stack.size() << ", credits: "
-                  << curr_credit << ", restarts: " << i << std::endl;
+        *out_ << "PRINT-INFO: total expansions: " << total_iterations
+                  << ", depth: " << depth << ", beam size: " << beam.size()
+                  << ", restarts: " << i << std::endl;
         print_char--;
-        if (print_char == 0) {
-          char_stack.top()->print(std::cout);
+        if (print_char == 0 && beam.empty() == false) {
+          beam.front()->print(*out_);
+          top.Print(*out_);
           print_char = cl_param.getIntParameter("-S");
         }
         start_count = std::chrono::system_clock::now();
       }
+    }
+  }
+  budget.Report(*out_);
+  top.Print(*out_);
+}
 
-      if (curr_credit == 0)
-        break;
+void Search::TwoStageSearch(Commandlineparser& cl_param,
+                            Configparser& config_param) {
 
-      if (backtrack)
-        guessed_box = backtrack_box;
+  double best_prob = -DBL_MAX;
 
-      unsigned int wbias = guesses.getSboxWeigthProb();
-      unsigned int whamming = guesses.getSboxWeightHamming();
-      //FIXME: get rid of the 10
-      auto rating = [wbias, whamming] (int bias, int hw_in, int hw_out) {
-        return wbias * std::abs(bias) + whamming * ((10 - hw_in) + (10 - hw_out));
-      };
-      if (char_stack.top()->guessbestsboxrandom(guessed_box, rating, guesses.getAlternativeSboxGuesses())) {
-//          std::cout << "worked " << char_stack.size() << std::endl;
-//          char_stack.top()->print(std::cout);
-        backtrack = false;
-        if (push_stack_rand(generator) <= guesses.getPushStackProb())
-          char_stack.emplace(char_stack.top()->clone());
-      } else {
-//          std::cout << "failed" << std::endl;
-//          char_stack.top()->print(std::cout);
-        char_stack.pop();
-        curr_credit--;
-        backtrack = true;
-        backtrack_box = guessed_box;
-        if (char_stack.size() == 1)
-          char_stack.emplace(working_copy->clone());
-      }
-      guesses.createMask(char_stack.top().get(), settings);
+  SearchSetup setup(cl_param, config_param);
+  if (Setup(cl_param, config_param, setup, true) == false)
+    return;
+  std::unique_ptr<Permutation>& working_copy = setup.working_copy_;
+  TopCharacteristics& top = setup.top_;
+  GuessStatistics& statistics = setup.statistics_;
+  SearchBudget& budget = setup.budget_;
+  Settings settings = config_param.getSettings();
+
+  TruncatedModel model(working_copy.get());
+  if (model.Supported() == false) {
+    *out_ << "Truncated model is not supported by this permutation"
+              << std::endl;
+    return;
+  }
+  std::set<ActivityPattern> tried;
+
+  auto start_count = std::chrono::system_clock::now();
+  Xoshiro256& generator = Random::Generator();
+
+  unsigned int interations = (unsigned int) cl_param.getIntParameter("-iter");
+  unsigned int patterns = 0, failed = 0, incomplete = 0;
+  for (unsigned int i = 0; i < interations && budget.Terminate() == false;
+      ++i) {
+    auto duration = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now() - start_count);
+    if (cl_param.getIntParameter("-I") > 0
+        && duration.count() > cl_param.getIntParameter("-I")) {
+      *out_ << "PRINT-INFO: activity patterns: " << patterns
+                << ", failed patterns: " << failed
+                << ", incomplete characteristics: " << incomplete
+                << ", iterations: " << i << std::endl;
+      top.Print(*out_);
+      start_count = std::chrono::system_clock::now();
+    }
+
+    // first stage: an activity pattern, which was not tried yet
+    ActivityPattern pattern;
+    std::unique_ptr<Permutation> constrained;
+    if (TruncatedPattern(model, working_copy.get(), config_param.getMaxActive(),
+                         config_param.getCredits(), generator, pattern,
+                         constrained) == false) {
+      failed++;
+      continue;
+    }
+    if (tried.insert(pattern).second == false)
+      continue;
+    patterns++;
+
+    // second stage: the bit level search for the given activity pattern
+    std::unique_ptr<Permutation> result;
+    if (CompleteCharacteristic(constrained.get(), settings,
+                               config_param.getCredits(), budget,
+                               result) == false) {
+      incomplete++;
+      continue;
     }
     double current_prob;
-    current_prob = KeccakProb(char_stack);
-    if (current_prob > best_prob && curr_credit > 0) {
+    if (config_param.printActive())
+      current_prob = -result->GetActiveSboxes();
+    else
+      current_prob = result->GetProbability();
+    top.Add(current_prob, result.get());
+    if (current_prob > best_prob) {
       best_prob = current_prob;
-      std::cout << "iteration: " << i << std::endl;
-      std::cout << "bias without last round: " << best_prob << std::endl;
-      char_stack.top()->PrintWithProbability();
+      Report(cl_param, config_param, budget, current_prob, result.get(),
+             "iteration: " + std::to_string(i));
+    }
+  }
+  SaveStatistics(cl_param, config_param, statistics);
+  budget.Report(*out_);
+  top.Print(*out_);
+}
+
+void Search::HullSearch(Commandlineparser& cl_param,
+                        Configparser& config_param) {
+
+  std::unique_ptr<Permutation> working_copy;
+
+  working_copy = config_param.getPermutation();
+  if (working_copy->checkchar(*out_) == false) {
+    *out_ << "Initial checkchar failed" << std::endl;
+    return;
+  }
+
+  // the input and output masks of the hull have to be fixed
+  unsigned int last = 2 * working_copy->rounds_;
+  for (unsigned int i : { 0U, last })
+    for (unsigned int w = 0; w < working_copy->state_masks_[i]->getnumwords();
+        ++w) {
+      unsigned int bits = working_copy->state_masks_[i]->getnumbits();
+      uint64_t all = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+      if (((*working_copy->state_masks_[i])[w].caremask.care & all) != all) {
+        *out_ << "The first and the last state have to be fixed"
+                  << std::endl;
+        return;
+      }
+    }
+
+  double threshold = cl_param.getFloatParameter("--hull-bias");
+  bool complete = true;
+  for (auto& layer : working_copy->sbox_layers_)
+    for (unsigned int pos = 0; pos < layer->GetNumSteps(); ++pos)
+      complete &= layer->SboxGuessable(pos) == false;
+  if (complete) {
+    *out_ << "given characteristic: bias 2^"
+              << working_copy->GetProbability() << ", correlation "
+              << working_copy->GetCorrelation() << std::endl;
+    if (threshold == 0)
+      threshold = working_copy->GetProbability()
+          - cl_param.getFloatParameter("--hull-margin");
+  } else if (threshold == 0) {
+    *out_ << "Either give a complete characteristic or --hull-bias"
+              << std::endl;
+    return;
+  }
+  *out_ << "enumerating characteristics with bias at least 2^"
+            << threshold << std::endl;
+
+  // only the first and the last state are kept, the linear layers of the
+  // propagated copy have already absorbed the fixed bits, so a fresh copy is
+  // taken
+  working_copy = config_param.getPermutation();
+  for (unsigned int i = 1; i < last; ++i)
+    working_copy->state_masks_[i]->SetState(BM_DUNNO);
+  for (auto& layer : working_copy->sbox_layers_)
+    for (unsigned int pos = 0; pos < layer->GetNumSteps(); ++pos)
+      layer->SetSboxActive(pos, false);
+  working_copy->touchall();
+  if (working_copy->update() == false) {
+    *out_ << "The masks of the hull are not compatible" << std::endl;
+    return;
+  }
+
+  SearchBudget budget(cl_param);
+  HullEnumerator enumerator(threshold, budget);
+  HullStatistics total;
+  unsigned int num_threads = std::max(1, cl_param.getIntParameter("--threads"));
+  std::vector<std::unique_ptr<Permutation>> work;
+  enumerator.Split(working_copy.get(), 16 * num_threads, work, total);
+
+  // the partial characteristics are enumerated in parallel
+  std::vector<HullStatistics> stats(num_threads);
+  std::atomic<unsigned int> next(0);
+  auto enumerate = [&enumerator, &work, &stats, &next] (unsigned int thread) {
+    for (unsigned int w = next++; w < work.size(); w = next++)
+      enumerator.Enumerate(work[w].get(), stats[thread]);
+  };
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < num_threads; ++t)
+    workers.emplace_back([&enumerate, t] {
+      Random::UseThread(t);
+      enumerate(t);
+    });
+  enumerate(0);
+  for (auto& worker : workers)
+    worker.join();
+  for (const auto& thread_stats : stats)
+    total.Merge(thread_stats);
+
+  if (budget.Terminate())
+    *out_ << "PRINT-INFO: enumeration stopped early, the hull is incomplete"
+              << std::endl;
+  *out_ << "enumerated partial characteristics: " << enumerator.nodes_
+            << std::endl;
+  total.Print(*out_);
+}
+
+void Search::MiddleOutSearch(Commandlineparser& cl_param,
+                             Configparser& config_param) {
+
+  double best_prob = -DBL_MAX;
+
+  SearchSetup setup(cl_param, config_param);
+  if (Setup(cl_param, config_param, setup, false) == false)
+    return;
+  std::unique_ptr<Permutation>& working_copy = setup.working_copy_;
+  TopCharacteristics& top = setup.top_;
+  GuessStatistics& statistics = setup.statistics_;
+  SearchBudget& budget = setup.budget_;
+
+  MiddleCatalogue catalogue(working_copy.get(), config_param.getMiddleState());
+  if (catalogue.Supported() == false) {
+    *out_ << "No S-box layer is next to the middle state" << std::endl;
+    return;
+  }
+  catalogue.Build(working_copy.get(), config_param.getCanonical());
+  if (catalogue.patterns_.empty()) {
+    *out_ << "No single S-box pattern fits the middle state"
+              << std::endl;
+    return;
+  }
+  *out_ << "PRINT-INFO: " << catalogue.patterns_.size()
+            << " middle patterns, best bias 2^"
+            << catalogue.patterns_.front().bound << std::endl;
+  Settings backward, forward;
+  catalogue.Split(config_param.getSettings(), backward, forward);
+
+  // the middle patterns are taken in the order of their bias by all threads
+  unsigned int iterations = (unsigned int) cl_param.getIntParameter("-iter");
+  unsigned int num_threads = std::max(1, cl_param.getIntParameter("--threads"));
+  std::atomic<unsigned int> next(0);
+  std::atomic<unsigned int> incomplete(0);
+  std::mutex print_mutex;
+  auto start_count = std::chrono::system_clock::now();
+  auto run = [&] () {
+    Settings thread_backward = backward, thread_forward = forward;
+    for (unsigned int i = next++; i < iterations && budget.Terminate() == false;
+        i = next++) {
+      // the random choices of a pattern do not depend on the thread it runs on
+      Random::UseStream(i);
+      const MiddlePattern& pattern =
+          catalogue.patterns_[i % catalogue.patterns_.size()];
+      std::unique_ptr<Permutation> seeded, half, result;
+      bool complete = catalogue.Seed(working_copy.get(), pattern, seeded)
+          && CompleteCharacteristic(seeded.get(), thread_backward,
+                                    config_param.getBackwardCredits(), budget,
+                                    half)
+          && CompleteCharacteristic(half.get(), thread_forward,
+                                    config_param.getForwardCredits(), budget,
+                                    result);
+      double current_prob = -DBL_MAX;
+      if (complete == false)
+        incomplete++;
+      else if (config_param.printActive())
+        current_prob = -(double) result->GetActiveSboxes();
+      else
+        current_prob = result->GetProbability();
+      if (complete)
+        top.Add(current_prob, result.get());
+
+      std::lock_guard<std::mutex> lock(print_mutex);
+      auto duration = std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now() - start_count);
+      if (cl_param.getIntParameter("-I") > 0
+          && duration.count() > cl_param.getIntParameter("-I")) {
+        *out_ << "PRINT-INFO: middle patterns: " << i
+                  << ", incomplete characteristics: " << incomplete
+                  << std::endl;
+        top.Print(*out_);
+        start_count = std::chrono::system_clock::now();
+      }
+      if (complete && current_prob > best_prob) {
+        best_prob = current_prob;
+        std::ostringstream label;
+        label << "iteration: " << i << ", middle box: " << pattern.box
+              << ", mask: " << std::hex << pattern.value;
+        Report(cl_param, config_param, budget, current_prob, result.get(),
+               label.str());
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < num_threads; ++t)
+    workers.emplace_back([&run, t] {
+      Random::UseThread(t);
+      run();
+    });
+  run();
+  for (auto& worker : workers)
+    worker.join();
+
+  SaveStatistics(cl_param, config_param, statistics);
+  budget.Report(*out_);
+  top.Print(*out_);
+}
+
+void Search::ExtendSearch(Commandlineparser& cl_param,
+                          Configparser& config_param) {
+
+  SearchSetup setup(cl_param, config_param);
+  if (Setup(cl_param, config_param, setup, false) == false)
+    return;
+  std::unique_ptr<Permutation>& working_copy = setup.working_copy_;
+  GuessStatistics& statistics = setup.statistics_;
+  SearchBudget& budget = setup.budget_;
+  unsigned int rounds = working_copy->rounds_;
+  unsigned int target = cl_param.getIntParameter("--extend-rounds") > 0 ?
+      cl_param.getIntParameter("--extend-rounds") : rounds + 1;
+  unsigned int restarts = std::max(1, cl_param.getIntParameter("--extend-restarts"));
+  unsigned int capacity = std::max(1, cl_param.getIntParameter("--top"));
+  InstallStopHandlers();
+  RoundExtension extension(config_param.getPermutationName());
+
+  auto rate = [&config_param] (Permutation* perm) {
+    if (config_param.printActive())
+      return -(double) perm->GetActiveSboxes();
+    return perm->GetProbability();
+  };
+
+  // the characteristics of the first round count are read, given by the
+  // search file or searched
+  std::vector<std::unique_ptr<Permutation>> trails;
+  if (std::strlen(cl_param.getParameter("--trails")) != 0) {
+    if (extension.ReadTrails(cl_param.getParameter("--trails"), rounds,
+                             trails) == false)
+      return;
+    for (auto& trail : trails)
+      trail->canonical_ = working_copy->canonical_;
+  } else {
+    Settings settings = config_param.getSettings();
+    TopCharacteristics found(capacity);
+    for (unsigned int i = 0; i < restarts && budget.Terminate() == false;
+        ++i) {
+      std::unique_ptr<Permutation> result;
+      if (CompleteCharacteristic(working_copy.get(), settings,
+                                 config_param.getCredits(), budget, result))
+        found.Add(rate(result.get()), result.get());
+    }
+    trails = found.Characteristics();
+  }
+  if (trails.empty()) {
+    *out_ << "No characteristic with " << rounds << " rounds to extend"
+              << std::endl;
+    return;
+  }
+  *out_ << "PRINT-INFO: " << rounds << " rounds: " << trails.size()
+            << " characteristics, best bias 2^"
+            << trails.front()->GetProbability() << std::endl;
+
+  // every characteristic is extended at both ends, the best ones of a round
+  // count are extended further
+  for (unsigned int current = rounds; current < target; ++current) {
+    Settings settings = extension.ExtendSettings(config_param.getSettings(),
+                                                 current + 1);
+    TopCharacteristics found(capacity);
+    for (auto& trail : trails)
+      for (bool append : { true, false }) {
+        std::unique_ptr<Permutation> extended;
+        if (extension.Extend(trail.get(), append, extended) == false)
+          continue;
+        for (unsigned int i = 0; i < restarts && budget.Terminate() == false;
+            ++i) {
+          std::unique_ptr<Permutation> result;
+          if (CompleteCharacteristic(extended.get(), settings,
+                                     config_param.getCredits(), budget, result))
+            found.Add(rate(result.get()), result.get());
+        }
+      }
+    trails = found.Characteristics();
+    if (trails.empty()) {
+      *out_ << "No characteristic with " << current + 1 << " rounds found"
+                << std::endl;
+      break;
+    }
+    *out_ << "PRINT-INFO: " << current + 1 << " rounds: " << trails.size()
+              << " characteristics" << std::endl;
+    Report(cl_param, config_param, budget, rate(trails.front().get()),
+           trails.front().get(), "best of " + std::to_string(current + 1)
+               + " rounds");
+    for (unsigned int t = 1; t < trails.size(); ++t)
+      StoreTrail(cl_param, config_param, rate(trails[t].get()), trails[t].get());
+    if (budget.Terminate())
+      break;
+  }
+
+  SaveStatistics(cl_param, config_param, statistics);
+  budget.Report(*out_);
+  if (cl_param.getIntParameter("--top") > 0) {
+    TopCharacteristics top(capacity);
+    for (auto& trail : trails)
+      top.Add(rate(trail.get()), trail.get());
+    top.Print(*out_);
+  }
+}
+
+void Search::MinActiveSearch(Commandlineparser& cl_param,
+                             Configparser& config_param) {
+
+  std::unique_ptr<Permutation> working_copy;
+
+  working_copy = config_param.getPermutation();
+  if (working_copy->checkchar(*out_) == false) {
+    *out_ << "Initial checkchar failed" << std::endl;
+    return;
+  }
+  SearchBudget budget(cl_param);
+
+  TruncatedModel model(working_copy.get());
+  if (model.Supported() == false) {
+    *out_ << "Truncated model is not supported by this permutation"
+              << std::endl;
+    return;
+  }
+  MinimumActive minimum_active(model, working_copy.get(), *out_);
+  unsigned int max_active = config_param.getMaxActive();
+  unsigned int layers = model.getNumLayers();
+
+  // the minima of the windows are lower bounds for the layers of every
+  // characteristic, so they are computed without the masks of the search
+  // file, which keeps the windows rotation invariant
+  std::unique_ptr<Permutation> relaxed = config_param.getPermutation();
+  for (auto& state : relaxed->state_masks_)
+    state->SetState(BM_DUNNO);
+  for (auto& layer : relaxed->sbox_layers_)
+    for (unsigned int pos = 0; pos < layer->GetNumSteps(); ++pos)
+      layer->SetSboxActive(pos, false);
+  relaxed->touchall();
+  bool bounded = relaxed->update()
+      && minimum_active.ComputeBounds(relaxed.get(), max_active, budget);
+  for (unsigned int length = 1; length < layers; ++length) {
+    *out_ << "PRINT-INFO: " << length << " S-box layers:";
+    for (unsigned int first = 0; first + length <= layers; ++first) {
+      unsigned int bound = minimum_active.Bound(first, first + length - 1);
+      *out_ << " " << (bound ? std::to_string(bound) : "?");
     }
-    while (char_stack.size())
+    *out_ << std::endl;
+  }
+  if (bounded == false) {
+    if (minimum_active.Stopped())
+      *out_ << "The search stopped while bounding the windows"
+                << std::endl;
+    else
+      *out_ << "No activity pattern with at most " << max_active
+                << " active S-boxes" << std::endl;
+    budget.Report(*out_);
+    return;
+  }
+
+  unsigned int minimum;
+  ActivityPattern pattern;
+  std::unique_ptr<Permutation> result;
+  bool found = minimum_active.Search(working_copy.get(), max_active, budget,
+                                     minimum, pattern, result);
+  *out_ << "PRINT-INFO: nodes: " << minimum_active.getNodes()
+            << std::endl;
+  if (found == false) {
+    if (minimum_active.Stopped())
+      *out_ << "The search stopped, at least " << minimum
+                << " active S-boxes" << std::endl;
+    else
+      *out_ << "No activity pattern with at most " << max_active
+                << " active S-boxes" << std::endl;
+    budget.Report(*out_);
+    return;
+  }
+
+  *out_ << "minimum: " << minimum << " active S-boxes" << std::endl;
+  for (unsigned int layer = 0; layer < layers; ++layer) {
+    unsigned int active = 0;
+    std::string line;
+    for (unsigned int box = model.getLayerBegin(layer);
+        box < model.getLayerEnd(layer); ++box) {
+      active += pattern[box] == TR_ACTIVE;
+      line += pattern[box] == TR_ACTIVE ? '1' : '0';
+    }
+    *out_ << "Round " << layer << " active sboxes: " << active << std::endl
+              << line << std::endl;
+  }
+
+  // the activity pattern is only a relaxation, the bit level search tells if
+  // a characteristic reaches the minimum
+  Settings settings = config_param.getSettings();
+  std::unique_ptr<Permutation> characteristic;
+  if (CompleteCharacteristic(result.get(), settings, config_param.getCredits(),
+                             budget, characteristic)) {
+    *out_ << "characteristic with the minimum:" << std::endl;
+    characteristic->PrintWithProbability(*out_);
+  } else {
+    *out_ << "No characteristic found for the activity pattern"
+              << std::endl;
+  }
+}
+
+SearchSetup::SearchSetup(Commandlineparser& cl_param,
+                         Configparser& config_param)
+    : working_copy_(config_param.getPermutation()),
+      top_(cl_param.getIntParameter("--top")),
+      statistics_(config_param.getLearnWeight(), config_param.getLearnDecay()),
+      nogoods_(config_param.getNogoods()),
+      budget_(cl_param) {
+}
+
+bool Search::Setup(Commandlineparser& cl_param, Configparser& config_param,
+                   SearchSetup& setup, bool rotate) {
+  Permutation* perm = setup.working_copy_.get();
+  if (perm->checkchar(*out_) == false) {
+    *out_ << "Initial checkchar failed" << std::endl;
+    return false;
+  }
+  // searches which keep the given rotation only hash canonically
+  if (rotate == false) {
+    perm->canonical_ = config_param.getCanonical();
+  } else if (config_param.getCanonical() && Canonicalize(perm) == false) {
+    *out_ << "Rotating the characteristic failed" << std::endl;
+    return false;
+  }
+  if (setup.top_.Enabled())
+    InstallStopHandlers();
+  UseStatistics(cl_param, config_param, setup.statistics_, perm);
+  if (setup.nogoods_.Enabled())
+    perm->nogoods_ = &setup.nogoods_;
+  return true;
+}
+
+bool Search::Canonicalize(Permutation* perm) {
+  // rotated copies of a characteristic share their transposition table
+  // entries, a rotation invariant start is rotated to an active bit 0
+  perm->canonical_ = true;
+  if (perm->anchorRotation() == false)
+    return true;
+  *out_ << "PRINT-INFO: rotation fixed by an active S-box at bit 0"
+            << std::endl;
+  return perm->update();
+}
+
+void Search::UseStatistics(Commandlineparser& cl_param,
+                           Configparser& config_param,
+                           GuessStatistics& statistics, Permutation* perm) {
+  // the statistics of former runs of the same permutation are continued
+  if (statistics.Enabled() == false)
+    return;
+  perm->statistics_ = &statistics;
+  std::string filename = cl_param.getParameter("--statistics");
+  std::string config = ConfigName(config_param, perm->rounds_);
+  if (filename.empty() == false && statistics.Load(filename, config))
+    *out_ << "PRINT-INFO: loaded statistics of " << statistics.size()
+              << " guesses" << std::endl;
+}
+
+void Search::SaveStatistics(Commandlineparser& cl_param,
+                            Configparser& config_param,
+                            GuessStatistics& statistics) {
+  std::string filename = cl_param.getParameter("--statistics");
+  if (statistics.Enabled() == false || filename.empty())
+    return;
+  std::string config = ConfigName(config_param, config_param.perm_->rounds_);
+  if (statistics.Save(filename, config) == false)
+    *out_ << "Saving the statistics to " << filename << " failed"
+              << std::endl;
+}
+
+void Search::SaveCheckpoint(SearchCheckpoint& checkpoint,
+                            const std::string& config, CheckpointState& state,
+                            std::stack<std::unique_ptr<Permutation>>& char_stack,
+                            TopCharacteristics& top,
+                            GuessStatistics& statistics,
+                            RestartPolicy& restarts, BoxActivity& activity,
+                            Xoshiro256& generator, Permutation* best) {
+  std::ostringstream generator_state, statistics_state, restart_state,
+      activity_state;
+  generator_state << generator;
+  state.generator_ = generator_state.str();
+  // the counts are written with all digits of a float
+  statistics_state << std::setprecision(9);
+  statistics.Write(statistics_state);
+  state.statistics_ = statistics_state.str();
+  restarts.Write(restart_state);
+  state.restarts_ = restart_state.str();
+  activity.Write(activity_state);
+  state.activity_ = activity_state.str();
+  if (best != nullptr)
+    state.best_ = best->clone();
+  state.top_ = top.Characteristics();
+  state.top_bias_ = top.Biases();
+  checkpoint.Save(config, state, char_stack);
+}
+
+bool Search::Resume(const std::string& filename, const std::string& config,
+                    Permutation* prototype, CheckpointState& state,
+                    TopCharacteristics& top, GuessStatistics& statistics,
+                    RestartPolicy& restarts, BoxActivity& activity,
+                    Xoshiro256& generator, SearchBudget& budget) {
+  if (SearchCheckpoint::Load(filename, config, prototype, state, *out_)
+      == false)
+    return false;
+  if (state.stack_.size() < 2 || state.start_ == nullptr) {
+    *out_ << "The checkpoint " << filename << " has no stack" << std::endl;
+    return false;
+  }
+  std::istringstream generator_state(state.generator_);
+  std::istringstream statistics_state(state.statistics_);
+  std::istringstream restart_state(state.restarts_);
+  std::istringstream activity_state(state.activity_);
+  generator_state >> generator;
+  statistics.Read(statistics_state);
+  restarts.Read(restart_state);
+  activity.Read(activity_state);
+  for (unsigned int i = 0; i < state.top_.size(); ++i)
+    top.Add(state.top_bias_[i], state.top_[i].get());
+  if (state.best_)
+    budget.Found(state.best_prob_, state.best_.get());
+  *out_ << "PRINT-INFO: resumed in restart " << state.restart_
+            << " with a stack of " << state.stack_.size()
+            << " characteristics" << std::endl;
+  return true;
+}
+
+std::string Search::ConfigName(Configparser& config_param,
+                               unsigned int rounds) {
+  return config_param.getPermutationName() + " " + std::to_string(rounds)
+      + " rounds";
+}
+
+void Search::Report(Commandlineparser& cl_param, Configparser& config_param,
+                    SearchBudget& budget, double bias, Permutation* perm,
+                    const std::string& label) {
+  // every characteristic a search reports passes here
+  budget.Found(bias, perm);
+  Metrics::Count(METRIC_CHARACTERISTICS);
+  StoreTrail(cl_param, config_param, bias, perm);
+  std::lock_guard<std::mutex> lock(report_mutex_);
+  best_bias_ = std::max(best_bias_, bias);
+  if (writer_ == nullptr)
+    writer_.reset(new TrailWriter(cl_param.getParameter("--format"),
+                                  cl_param.getParameter("--output"),
+                                  config_param.getPermutationName(), *out_));
+  writer_->Write(label, bias, perm);
+}
+
+double Search::getBestBias() {
+  std::lock_guard<std::mutex> lock(report_mutex_);
+  return best_bias_;
+}
+
+void Search::StoreTrail(Commandlineparser& cl_param,
+                        Configparser& config_param, double bias,
+                        Permutation* perm) {
+  std::lock_guard<std::mutex> lock(report_mutex_);
+  if (trail_db_ == nullptr)
+    trail_db_.reset(new TrailDatabase(cl_param.getParameter("--trail-db"),
+                                      config_param.getPermutationName()));
+  if (trail_db_->Enabled())
+    trail_db_->Add(bias, perm);
+}
+
+void Search::LoadSeeds(Commandlineparser& cl_param, Configparser& config_param,
+                       Permutation* start, std::vector<MaskPlanes>& seeds) {
+  TrailDatabase database(cl_param.getParameter("--seed-from"),
+                         config_param.getPermutationName());
+  std::vector<StoredTrail> trails;
+  if (database.Enabled() == false
+      || database.Read(start->rounds_, trails) == false)
+    return;
+
+  // only the characteristics which fit the search file are used
+  for (const StoredTrail& trail : trails) {
+    std::unique_ptr<Permutation> perm = start->clone();
+    if (perm->SetPlanes(trail.planes_))
+      seeds.push_back(trail.planes_);
+  }
+  *out_ << "PRINT-INFO: " << seeds.size() << " of " << trails.size()
+            << " stored characteristics fit the search file" << std::endl;
+}
+
+bool Search::Unfix(const MaskPlanes& seed, Permutation* start,
+                   Xoshiro256& generator,
+                   std::unique_ptr<Permutation>& result) {
+  // the input and the output of a random linear layer are reset to the
+  // search file, so the S-boxes around it are guessed again
+  MaskPlanes planes = seed, original;
+  start->GetPlanes(original);
+  LinearLayer* layer =
+      start->linear_layers_[generator() % start->linear_layers_.size()].get();
+  unsigned int offset = 0;
+  for (auto& state : start->state_masks_) {
+    if (state.get() == layer->in || state.get() == layer->out)
+      for (unsigned int w = 0; w < state->getnumwords(); ++w)
+        planes[offset + w] = original[offset + w];
+    offset += state->getnumwords();
+  }
+  result = start->clone();
+  return result->SetPlanes(planes);
+}
+
+void Search::TuneSettings(Commandlineparser& cl_param,
+                          Configparser& config_param) {
+
+  double best_prob = -DBL_MAX;
+
+  SearchSetup setup(cl_param, config_param);
+  if (Setup(cl_param, config_param, setup, true) == false)
+    return;
+  std::unique_ptr<Permutation>& working_copy = setup.working_copy_;
+  TopCharacteristics& top = setup.top_;
+  GuessStatistics& statistics = setup.statistics_;
+  SearchBudget& budget = setup.budget_;
+
+  auto start_count = std::chrono::system_clock::now();
+  Xoshiro256& generator = Random::Generator();
+  SettingsBandit bandit(config_param.getSettings(),
+                        std::max(1, cl_param.getIntParameter("--arms")),
+                        generator);
+
+  unsigned int interations = (unsigned int) cl_param.getIntParameter("-iter");
+  for (unsigned int i = 0; i < interations && budget.Terminate() == false;
+      ++i) {
+    auto duration = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now() - start_count);
+    if (cl_param.getIntParameter("-I") > 0
+        && duration.count() > cl_param.getIntParameter("-I")) {
+      *out_ << "PRINT-INFO: restarts: " << i << std::endl;
+      bandit.PrintStatus(*out_);
+      top.Print(*out_);
+      start_count = std::chrono::system_clock::now();
+    }
+
+    // each restart uses the settings of the arm chosen by the bandit
+    unsigned int arm = bandit.Select();
+    std::clock_t start_clock = std::clock();
+    std::unique_ptr<Permutation> result;
+    bool complete = CompleteCharacteristic(working_copy.get(),
+                                           bandit.arms_[arm].settings_,
+                                           config_param.getCredits(), budget,
+                                           result);
+    double seconds = (double) (std::clock() - start_clock) / CLOCKS_PER_SEC;
+
+    // the reward halves with each bit the bias gets worse
+    double current_prob = -DBL_MAX, reward = 0;
+    if (complete) {
+      if (config_param.printActive())
+        current_prob = -(double) result->GetActiveSboxes();
+      else
+        current_prob = result->GetProbability();
+      top.Add(current_prob, result.get());
+      if (current_prob > best_prob) {
+        best_prob = current_prob;
+        Report(cl_param, config_param, budget, current_prob, result.get(),
+               "iteration: " + std::to_string(i) + ", arm: "
+                   + std::to_string(arm));
+      }
+      reward = std::exp2(current_prob);
+    }
+    bandit.Update(arm, reward, std::max(seconds, 1e-6), current_prob);
+  }
+
+  bandit.PrintStatus(*out_);
+  *out_ << "Best settings (arm " << bandit.Best() << "):" << std::endl;
+  bandit.PrintSettings(*out_, bandit.Best());
+  SaveStatistics(cl_param, config_param, statistics);
+  budget.Report(*out_);
+  top.Print(*out_);
+}
+
+bool Search::TruncatedPattern(TruncatedModel& model, Permutation* start,
+                              unsigned int max_active, unsigned int credits,
+                              Xoshiro256& generator, ActivityPattern& pattern,
+                              std::unique_ptr<Permutation>& result) {
+  struct Decision {
+    ActivityPattern before;
+    unsigned int position;
+    bool flipped;
+  };
+  std::vector<Decision> decisions;
+
+  // depth-first over the boxes in random order, inactive boxes first
+  std::vector<unsigned int> order(model.getNumBoxes());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), generator);
+
+  // the decisions are only propagated by the truncated model, the bit level
+  // propagation only checks the complete patterns
+  model.InitPattern(start, pattern);
+  bool works = model.Propagate(pattern, max_active);
+  unsigned int position = 0;
+  bool rejected_by_masks = false;
+  while (true) {
+    if (works) {
+      while (position < order.size() && pattern[order[position]] != TR_DUNNO)
+        ++position;
+      if (position < order.size()) {
+        decisions.push_back(Decision { pattern, position, false });
+        pattern[order[position]] = TR_INACTIVE;
+        works = model.Propagate(pattern, max_active);
+        continue;
+      }
+      result = start->clone();
+      if (model.Apply(pattern, result.get()))
+        return true;
+      rejected_by_masks = true;
+
+      // the masks only reject a complete pattern, so the search jumps back to
+      // the first decision after which the masks reject the partial pattern,
+      // the partial patterns only get more constrained with every decision
+      auto rejected = [&] (unsigned int decision) {
+        ActivityPattern partial = decision + 1 < decisions.size() ?
+            decisions[decision + 1].before : pattern;
+        std::unique_ptr<Permutation> perm(start->clone());
+        return model.Apply(partial, perm.get()) == false;
+      };
+      if (decisions.empty() == false) {
+        unsigned int low = 0, high = decisions.size() - 1;
+        while (low < high) {
+          unsigned int middle = (low + high) / 2;
+          if (rejected(middle))
+            high = middle;
+          else
+            low = middle + 1;
+        }
+        decisions.erase(decisions.begin() + low + 1, decisions.end());
+      }
+    }
+    while (decisions.empty() == false && decisions.back().flipped)
+      decisions.pop_back();
+    if (decisions.empty() || credits == 0)
+      return false;
+    credits--;
+    decisions.back().flipped = true;
+    pattern = decisions.back().before;
+    position = decisions.back().position;
+    pattern[order[position]] = TR_ACTIVE;
+    works = model.Propagate(pattern, max_active);
+
+    // after the masks rejected a pattern, the other branch also starts with
+    // the boxes which the masks decide
+    if (works && rejected_by_masks) {
+      std::unique_ptr<Permutation> perm(start->clone());
+      works = model.Apply(pattern, perm.get())
+          && model.Propagate(pattern, max_active);
+    }
+    rejected_by_masks = false;
+  }
+}
+
+bool Search::CompleteCharacteristic(Permutation* start, Settings& settings,
+                                    unsigned int credits, SearchBudget& budget,
+                                    std::unique_ptr<Permutation>& result) {
+  std::stack<std::unique_ptr<Permutation>> char_stack;
+  GuessMask guesses;
+  SboxPos guessed_box(0, 0);
+  SboxPos backtrack_box(0, 0);
+  bool backtrack = false;
+  bool active;
+
+  Xoshiro256& generator = Random::Generator();
+  std::uniform_real_distribution<float> push_stack_rand(0.0, 1.0);
+
+  if (start->statistics_ != nullptr)
+    start->statistics_->Decay();
+  char_stack.emplace(start->clone());
+  char_stack.emplace(start->clone());
+  guesses.createMask(char_stack.top().get(), settings);
+  while (guesses.getRandPos(guessed_box, active)) {
+    if (credits == 0 || budget.Terminate())
+      return false;
+
+    if (backtrack)
+      guessed_box = backtrack_box;
+
+    auto rating = guesses.getRating();
+    Metrics::Depth(char_stack.size());
+    if (char_stack.top()->guessbestsboxrandom(
+        guessed_box, rating, guesses.getAlternativeSboxGuesses())) {
+      backtrack = false;
+      if (push_stack_rand(generator) <= guesses.getPushStackProb())
+        char_stack.emplace(char_stack.top()->clone());
+    } else {
       char_stack.pop();
+      credits--;
+      backtrack = true;
+      backtrack_box = guessed_box;
+      if (char_stack.size() == 1)
+        char_stack.emplace(start->clone());
+    }
+    guesses.createMask(char_stack.top().get(), settings);
   }
+  result = std::move(char_stack.top());
+  if (result->statistics_ != nullptr)
+    result->statistics_->Success(result->decisions_);
+  return true;
 }
 
-double Search::KeccakProb(std::stack<std::unique_ptr<Permutation>>& char_stack) {
+double Search::KeccakProb(Permutation* perm, bool bound) {
   double prob = 0.0;
   double temp_prob;
 
-  for (unsigned i = 0; i < char_stack.top()->sbox_layers_.size() - 1; ++i) {
-    temp_prob = char_stack.top()->sbox_layers_[i]->GetProbability();
+  for (unsigned i = 0; i < perm->sbox_layers_.size() - 1; ++i) {
+    if (bound)
+      temp_prob = perm->sbox_layers_[i]->GetProbabilityBound();
+    else
+      temp_prob = perm->sbox_layers_[i]->GetProbability();
     prob += temp_prob;
   }
 
-  prob += char_stack.top()->sbox_layers_.size() - 2;
+  prob += perm->sbox_layers_.size() - 2;
 
   return prob;
 }
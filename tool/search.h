@@ -34,24 +34,120 @@ For more information, please refer to <http://unlicense.org/>
 #include <vector>
 #include <assert.h>
 #include <stack>
+#include <thread>
+#include <algorithm>
+#include <unordered_set>
+#include <set>
+#include <numeric>
+#include <ctime>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <functional>
 
 #include "permutation.h"
 #include "mask.h"
 #include "guessmask.h"
+#include "statehash.h"
+#include "nogood.h"
+#include "truncated.h"
+#include "tuning.h"
+#include "topcharacteristics.h"
+#include "budget.h"
+#include "hull.h"
+#include "middleout.h"
+#include "extension.h"
+#include "minactive.h"
+#include "checkpoint.h"
+#include "restart.h"
+#include "guesstrace.h"
+#include "traildb.h"
+#include "trailwriter.h"
+#include "metrics.h"
+#include "random.h"
 #include "configparser.h"
 #include "commandlineparser.h"
 
+// what every search starts from, prepared by Search::Setup
+struct SearchSetup {
+  SearchSetup(Commandlineparser& cl_param, Configparser& config_param);
+
+  std::unique_ptr<Permutation> working_copy_;
+  TopCharacteristics top_;
+  GuessStatistics statistics_;
+  NogoodTable nogoods_;
+  SearchBudget budget_;
+};
+
 class Search {
 
  public:
   Search(Permutation &perm);
   void StackSearch1(Commandlineparser& cl_param, Configparser& config_param);
   void StackSearchKeccak(Commandlineparser& cl_param, Configparser& config_param);
+  void BeamSearch(Commandlineparser& cl_param, Configparser& config_param);
+  void TwoStageSearch(Commandlineparser& cl_param, Configparser& config_param);
+  void TuneSettings(Commandlineparser& cl_param, Configparser& config_param);
+  void HullSearch(Commandlineparser& cl_param, Configparser& config_param);
+  void MiddleOutSearch(Commandlineparser& cl_param, Configparser& config_param);
+  void ExtendSearch(Commandlineparser& cl_param, Configparser& config_param);
+  void MinActiveSearch(Commandlineparser& cl_param, Configparser& config_param);
+  double getBestBias();
+  // where the searches print to, std::cout unless set
+  void setOutput(std::ostream& out);
 
  private:
-  double KeccakProb(std::stack<std::unique_ptr<Permutation>>& char_stack);
+  // the restart loop of search and keccak, which differ in the rating and
+  // the report
+  void StackSearch(Commandlineparser& cl_param, Configparser& config_param,
+                   std::function<double(Permutation*)> rate,
+                   std::function<std::string(unsigned int, double)> label);
+  double KeccakProb(Permutation* perm, bool bound);
+  bool TruncatedPattern(TruncatedModel& model, Permutation* start,
+                        unsigned int max_active, unsigned int credits,
+                        Xoshiro256& generator, ActivityPattern& pattern,
+                        std::unique_ptr<Permutation>& result);
+  bool CompleteCharacteristic(Permutation* start, Settings& settings,
+                              unsigned int credits, SearchBudget& budget,
+                              std::unique_ptr<Permutation>& result);
+  bool Setup(Commandlineparser& cl_param, Configparser& config_param,
+             SearchSetup& setup, bool rotate);
+  bool Canonicalize(Permutation* perm);
+  void UseStatistics(Commandlineparser& cl_param, Configparser& config_param,
+                     GuessStatistics& statistics, Permutation* perm);
+  void SaveStatistics(Commandlineparser& cl_param, Configparser& config_param,
+                      GuessStatistics& statistics);
+  void SaveCheckpoint(SearchCheckpoint& checkpoint, const std::string& config,
+                      CheckpointState& state,
+                      std::stack<std::unique_ptr<Permutation>>& char_stack,
+                      TopCharacteristics& top, GuessStatistics& statistics,
+                      RestartPolicy& restarts, BoxActivity& activity,
+                      Xoshiro256& generator, Permutation* best);
+  bool Resume(const std::string& filename, const std::string& config,
+              Permutation* prototype, CheckpointState& state,
+              TopCharacteristics& top, GuessStatistics& statistics,
+              RestartPolicy& restarts, BoxActivity& activity,
+              Xoshiro256& generator, SearchBudget& budget);
+  std::string ConfigName(Configparser& config_param, unsigned int rounds);
+  void Report(Commandlineparser& cl_param, Configparser& config_param,
+              SearchBudget& budget, double bias, Permutation* perm,
+              const std::string& label);
+  void StoreTrail(Commandlineparser& cl_param, Configparser& config_param,
+                  double bias, Permutation* perm);
+  void LoadSeeds(Commandlineparser& cl_param, Configparser& config_param,
+                 Permutation* start, std::vector<MaskPlanes>& seeds);
+  bool Unfix(const MaskPlanes& seed, Permutation* start,
+             Xoshiro256& generator, std::unique_ptr<Permutation>& result);
 
   Permutation *perm_;
+  std::ostream* out_;
+  std::mutex report_mutex_;
+  std::unique_ptr<TrailDatabase> trail_db_;  // opened by the first trail
+  std::unique_ptr<TrailWriter> writer_;
+  double best_bias_;  // of all reported characteristics
 
 };
 
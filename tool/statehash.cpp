@@ -0,0 +1,44 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "statehash.h"
+
+StateHash::StateHash()
+    : key_(0x736f6d6570736575ULL),
+      check_(0x646f72616e646f6dULL) {
+}
+
+void StateHash::Add(uint64_t value) {
+  // two independent splitmix64 style chains
+  key_ ^= value;
+  key_ = (key_ ^ (key_ >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  key_ = (key_ ^ (key_ >> 27)) * 0x94d049bb133111ebULL;
+  key_ ^= key_ >> 31;
+  check_ += value + 0x9e3779b97f4a7c15ULL;
+  check_ = (check_ ^ (check_ >> 33)) * 0xff51afd7ed558ccdULL;
+  check_ = (check_ ^ (check_ >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+  check_ ^= check_ >> 33;
+}
@@ -35,6 +35,7 @@ For more information, please refer to <http://unlicense.org/>
 
 #include "cache.h"
 #include "mask.h"
+#include "trace.h"
 
 template <unsigned bitsize, unsigned words> struct Row; // forward declaration for friends below
 template <unsigned bitsize, unsigned words> Row<bitsize, words> operator^(const Row<bitsize, words>& left, const Row<bitsize, words>& right);
@@ -97,6 +98,7 @@ struct LinearStep {
   bool AddRow(const Row<bitsize, words>& row);
   bool ExtractMasks(std::array<Mask*, words>& x, std::array<Mask*, words>& y);
   bool Update(std::array<Mask*, words> x, std::array<Mask*, words> y);
+  void Apply(const BitVector* x, BitVector* y) const;
   LinearStep<bitsize, words>& operator=(const LinearStep<bitsize, words>& rhs);
 
   friend std::ostream& operator<<<>(std::ostream& stream, const LinearStep<bitsize, words>& sys);
@@ -317,6 +317,7 @@ bool LinearStep<bitsize, words>::AddMasks(std::array<Mask*, words>& x, std::arra
 
 template<unsigned bitsize, unsigned words>
 bool LinearStep<bitsize, words>::AddRow(const Row<bitsize, words>& row) {
+  TRACE_SCOPE("LinearStep::AddRow");
   // assumes that only one variable is set!!
   for (Row<bitsize, words>& other : rows) { // maybe optimize via pivots
     if (other.CommonVariableWith(row)) {
@@ -384,3 +385,13 @@ bool LinearStep<bitsize, words>::Update(std::array<Mask*, words> x,std::array<Ma
   return false;
 }
 
+
+template <unsigned bitsize, unsigned words>
+void LinearStep<bitsize, words>::Apply(const BitVector* x, BitVector* y) const {
+  std::array<BitVector, words> x_words;
+  for (unsigned w = 0; w < words; ++w)
+    x_words[w] = x[w];
+  std::array<BitVector, words> y_words = fun_(x_words);
+  for (unsigned w = 0; w < words; ++w)
+    y[w] = y_words[w];
+}
@@ -38,9 +38,14 @@ For more information, please refer to <http://unlicense.org/>
 #include <iterator>
 #include <chrono>
 #include <random>
+#include <algorithm>
 
 #include "cache.h"
+#include "guesstrace.h"
 #include "mask.h"
+#include "metrics.h"
+#include "trace.h"
+#include "random.h"
 
 struct NonlinearStepUpdateInfo{
   bool is_active_;
@@ -49,6 +54,14 @@ struct NonlinearStepUpdateInfo{
   WordMask outmask_;
 };
 
+// adds a bonus to the rating of the masks (in, out) of the box which is
+// guessed, set by the current thread for the duration of a guess
+struct GuessOrdering {
+  virtual ~GuessOrdering() {}
+  virtual int Bonus(unsigned int in, unsigned int out) const = 0;
+};
+extern thread_local const GuessOrdering* guess_ordering;
+
 template <unsigned bitsize> struct LinearDistributionTable; 
 template <unsigned bitsize> std::ostream& operator<<(std::ostream& stream, const LinearDistributionTable<bitsize>& ldt);
 
@@ -77,12 +90,16 @@ struct NonlinearStep {
   void Initialize(std::function<BitVector(BitVector)> fun);
   void Initialize(std::shared_ptr<LinearDistributionTable<bitsize>> ldt);
   double GetProbability(Mask& x, Mask& y);
+  double GetCorrelation(Mask& x, Mask& y);
+  double GetProbabilityBound(Mask& x, Mask& y);
+  unsigned int CountCompatible(Mask& x, Mask& y);
   bool Update(Mask& x, Mask& y);
   bool Update(Mask& x, Mask& y, Cache<unsigned long long, NonlinearStepUpdateInfo>* box_cache);
   void TakeBestBox(Mask& x, Mask& y, std::function<int(int, int, int)> rating);
   int TakeBestBox(Mask& x, Mask& y, std::function<int(int, int, int)> rating, int pos);
   void TakeBestBoxRandom(Mask& x, Mask& y, std::function<int(int, int, int)> rating);
   unsigned long long getKey(Mask& in, Mask& out);
+  int Rate(std::function<int(int, int, int)>& rating, unsigned int inmask, unsigned int outmask);
   void create_masks(std::vector<unsigned int> &masks, Mask& reference, unsigned int pos = 0, unsigned int current_mask = 0);
   NonlinearStep<bitsize>& operator=(const NonlinearStep<bitsize>& rhs);
 
@@ -92,8 +109,17 @@ struct NonlinearStep {
   bool is_active_;
   bool is_guessable_;
   bool has_to_be_active_;
-  static std::vector<unsigned int> inmasks_, outmasks_;
-  static std::multimap<int, std::pair<unsigned int, unsigned int>, std::greater<int>> valid_masks_;
+  // scratch space of the guessing functions, one per thread
+  struct Scratch {
+    std::vector<unsigned int> inmasks_, outmasks_;
+    std::multimap<int, std::pair<unsigned int, unsigned int>, std::greater<int>> valid_masks_;
+    // number of compatible masks and bias bound per key of CountCompatible
+    // and GetProbabilityBound
+    const LinearDistributionTable<bitsize>* compatible_ldt_ = nullptr;
+    std::unordered_map<unsigned long long, unsigned int> compatible_;
+    std::unordered_map<unsigned long long, double> bound_;
+  };
+  static thread_local Scratch scratch_;
 };
 
 #include "step_nonlinear.hpp"
@@ -82,11 +82,7 @@ std::ostream& operator<<(std::ostream& stream, const LinearDistributionTable<bit
 //-----------------------------------------------------------------------------
 
 template <unsigned bitsize>
-std::vector<unsigned int> NonlinearStep<bitsize>::inmasks_;
-template <unsigned bitsize>
-std::vector<unsigned int>NonlinearStep<bitsize>::outmasks_;
-template <unsigned bitsize>
-std::multimap<int, std::pair<unsigned int, unsigned int>, std::greater<int>> NonlinearStep<bitsize>::valid_masks_;
+thread_local typename NonlinearStep<bitsize>::Scratch NonlinearStep<bitsize>::scratch_;
 
 template <unsigned bitsize>
 NonlinearStep<bitsize>::NonlinearStep(std::function<BitVector(BitVector)> fun) {
@@ -99,8 +95,8 @@ void NonlinearStep<bitsize>::Initialize(std::function<BitVector(BitVector)> fun)
   is_guessable_ = true;
   has_to_be_active_ = false;
   ldt_.reset(new LinearDistributionTable<bitsize>(fun));
-  inmasks_.reserve(bitsize);
-  outmasks_.reserve(bitsize);
+  scratch_.inmasks_.reserve(bitsize);
+  scratch_.outmasks_.reserve(bitsize);
 }
 
 template <unsigned bitsize>
@@ -109,12 +105,13 @@ void NonlinearStep<bitsize>::Initialize(std::shared_ptr<LinearDistributionTable<
   is_guessable_ = true;
   has_to_be_active_ = false;
   ldt_ = ldt;
-  inmasks_.reserve(bitsize*bitsize);
-  outmasks_.reserve(bitsize*bitsize);
+  scratch_.inmasks_.reserve(bitsize*bitsize);
+  scratch_.outmasks_.reserve(bitsize*bitsize);
 }
 
 template <unsigned bitsize>
 bool NonlinearStep<bitsize>::Update(Mask& x, Mask& y) {
+  TRACE_SCOPE("NonlinearStep::Update");
   std::vector<unsigned int> inmasks, outmasks;
   unsigned int inresult[2] = { 0, 0 };
   unsigned int outresult[2] = { 0, 0 };
@@ -170,12 +167,14 @@ template<unsigned bitsize>
 bool NonlinearStep<bitsize>::Update(
     Mask& x, Mask& y,
     Cache<unsigned long long, NonlinearStepUpdateInfo>* box_cache) {
+  TRACE_SCOPE("NonlinearStep::Update cached");
   NonlinearStepUpdateInfo stepdata;
   x.reinit_caremask();
   y.reinit_caremask();
   unsigned long long key = getKey(x, y);
 
   if (box_cache->find(key, stepdata)) {
+    Metrics::Count(METRIC_SBOX_CACHE_HITS);
     is_active_ = stepdata.is_active_;
     is_guessable_ = stepdata.is_guessable_;
     x.bitmasks = stepdata.inmask_;
@@ -189,6 +188,7 @@ bool NonlinearStep<bitsize>::Update(
     return true;
   }
 
+  Metrics::Count(METRIC_SBOX_CACHE_MISSES);
   if (Update(x, y)) {
     stepdata.is_active_ = is_active_;
     stepdata.is_guessable_ = is_guessable_;
@@ -203,6 +203,16 @@ bool NonlinearStep<bitsize>::Update(
   return false;
 }
 
+template<unsigned bitsize>
+int NonlinearStep<bitsize>::Rate(std::function<int(int, int, int)>& rating,
+                                 unsigned int inmask, unsigned int outmask) {
+  int rate = rating(ldt_->ldt[inmask][outmask], __builtin_popcount(inmask),
+                    __builtin_popcount(outmask));
+  if (guess_ordering != nullptr)
+    rate += guess_ordering->Bonus(inmask, outmask);
+  return rate;
+}
+
 template<unsigned bitsize>
 unsigned long long NonlinearStep<bitsize>::getKey(Mask& in, Mask& out) {
   return ((in.caremask.canbe1) << (3 * bitsize))
@@ -227,6 +237,77 @@ double NonlinearStep<bitsize>::GetProbability(Mask& x, Mask& y) {
 
 }
 
+template <unsigned bitsize>
+double NonlinearStep<bitsize>::GetCorrelation(Mask& x, Mask& y) {
+  std::vector<unsigned int> inmasks, outmasks;
+  create_masks(inmasks, x);
+  create_masks(outmasks, y);
+
+  // signed correlation 2 * bias, only defined for fully determined masks
+  if (inmasks.size() > 1 || outmasks.size() > 1)
+    return 0;
+  return (double) ldt_->ldt[inmasks[0]][outmasks[0]] / (1 << (bitsize - 1));
+}
+
+template <unsigned bitsize>
+double NonlinearStep<bitsize>::GetProbabilityBound(Mask& x, Mask& y) {
+  // the bound only depends on the known bits, so it is memoized per pattern
+  if (scratch_.compatible_ldt_ != ldt_.get()) {
+    scratch_.compatible_.clear();
+    scratch_.bound_.clear();
+    scratch_.compatible_ldt_ = ldt_.get();
+  }
+  unsigned long long key = (getKey(x, y) << 1) | has_to_be_active_;
+  auto entry = scratch_.bound_.find(key);
+  if (entry != scratch_.bound_.end())
+    return entry->second;
+
+  std::vector<unsigned int> inmasks, outmasks;
+  create_masks(inmasks, x);
+  create_masks(outmasks, y);
+
+  // the best bias of all masks which are compatible with x and y
+  int best = 0;
+  for (const auto& inmask : inmasks) {
+    if (has_to_be_active_ && inmask == 0)
+      continue;
+    for (const auto& outmask : outmasks)
+      best = std::max(best, std::abs(ldt_->ldt[inmask][outmask]));
+  }
+  double bound = -10000000;
+  if (best != 0)
+    bound = std::log2((double) best) - bitsize;
+  scratch_.bound_[key] = bound;
+  return bound;
+}
+
+template <unsigned bitsize>
+unsigned int NonlinearStep<bitsize>::CountCompatible(Mask& x, Mask& y) {
+  // the count only depends on the known bits, so it is memoized per pattern
+  if (scratch_.compatible_ldt_ != ldt_.get()) {
+    scratch_.compatible_.clear();
+    scratch_.bound_.clear();
+    scratch_.compatible_ldt_ = ldt_.get();
+  }
+  unsigned long long key = (getKey(x, y) << 1) | has_to_be_active_;
+  auto entry = scratch_.compatible_.find(key);
+  if (entry != scratch_.compatible_.end())
+    return entry->second;
+
+  std::vector<unsigned int> inmasks, outmasks;
+  create_masks(inmasks, x);
+  create_masks(outmasks, y);
+  unsigned int count = 0;
+  for (const auto& inmask : inmasks) {
+    if (has_to_be_active_ && inmask == 0)
+      continue;
+    for (const auto& outmask : outmasks)
+      count += ldt_->ldt_bool[inmask][outmask] != 0;
+  }
+  scratch_.compatible_[key] = count;
+  return count;
+}
+
 template <unsigned bitsize>
 NonlinearStep<bitsize>& NonlinearStep<bitsize>::operator=(const NonlinearStep<bitsize>& rhs){
   ldt_ = rhs.ldt_;
@@ -238,20 +319,21 @@ NonlinearStep<bitsize>& NonlinearStep<bitsize>::operator=(const NonlinearStep<bi
 
 template <unsigned bitsize>
 void NonlinearStep<bitsize>::TakeBestBox(Mask& x, Mask& y, std::function<int(int, int, int)> rating) {
-  inmasks_.clear();
-  outmasks_.clear();
-  create_masks(inmasks_, x);
-  create_masks(outmasks_, y);
+  TRACE_SCOPE("NonlinearStep::TakeBestBox");
+  scratch_.inmasks_.clear();
+  scratch_.outmasks_.clear();
+  create_masks(scratch_.inmasks_, x);
+  create_masks(scratch_.outmasks_, y);
 
     int best_rate = 0;
     unsigned int best_inmask = (unsigned int) has_to_be_active_;
     unsigned int best_outmask = 0;
 
-  for (const auto& inmask : inmasks_)
-    for (const auto& outmask : outmasks_) {
+  for (const auto& inmask : scratch_.inmasks_)
+    for (const auto& outmask : scratch_.outmasks_) {
       if(ldt_->ldt[inmask][outmask] != 0)
-       if(best_rate < rating(ldt_->ldt[inmask][outmask], __builtin_popcount (inmask), __builtin_popcount (outmask))){
-         best_rate = rating(ldt_->ldt[inmask][outmask], __builtin_popcount (inmask), __builtin_popcount (outmask));
+       if(best_rate < Rate(rating, inmask, outmask)){
+         best_rate = Rate(rating, inmask, outmask);
          best_inmask = inmask;
          best_outmask = outmask;
        }
@@ -277,17 +359,18 @@ void NonlinearStep<bitsize>::TakeBestBox(Mask& x, Mask& y, std::function<int(int
 template<unsigned bitsize>
 int NonlinearStep<bitsize>::TakeBestBox(
     Mask& x, Mask& y, std::function<int(int, int, int)> rating, int pos) {
-  inmasks_.clear();
-  outmasks_.clear();
-  create_masks(inmasks_, x);
-  create_masks(outmasks_, y);
-  valid_masks_.clear();
+  TRACE_SCOPE("NonlinearStep::TakeBestBox alternative");
+  scratch_.inmasks_.clear();
+  scratch_.outmasks_.clear();
+  create_masks(scratch_.inmasks_, x);
+  create_masks(scratch_.outmasks_, y);
+  scratch_.valid_masks_.clear();
 
   //FIXME: not nice, just to be able to set boxes active
   if (has_to_be_active_ == true){
-    for (auto it = inmasks_.begin(); it != inmasks_.end(); ++it)
+    for (auto it = scratch_.inmasks_.begin(); it != scratch_.inmasks_.end(); ++it)
       if (*it == 0) {
-        inmasks_.erase(it);
+        scratch_.inmasks_.erase(it);
         //FIXME: even worse
         if(pos > 0)
           --pos;
@@ -295,29 +378,28 @@ int NonlinearStep<bitsize>::TakeBestBox(
       }
   }
 
-  for (const auto& inmask : inmasks_)
-    for (const auto& outmask : outmasks_) {
+  for (const auto& inmask : scratch_.inmasks_)
+    for (const auto& outmask : scratch_.outmasks_) {
       if (ldt_->ldt[inmask][outmask] != 0) {
-        valid_masks_.insert(
+        scratch_.valid_masks_.insert(
             std::pair<int, std::pair<unsigned int, unsigned int>>(
-                rating(ldt_->ldt[inmask][outmask], __builtin_popcount(inmask),
-                       __builtin_popcount(outmask)),
+                Rate(rating, inmask, outmask),
                 std::pair<unsigned int, unsigned int>(inmask, outmask)));
       }
     }
 
-  assert(pos < (int)valid_masks_.size());
+  assert(pos < (int)scratch_.valid_masks_.size());
 
   for (unsigned int i = 0; i < bitsize; ++i) {
     x.bitmasks[i] = (
-        ((std::next(valid_masks_.begin(), pos)->second.first >> i) & 1) == 1 ?
+        ((std::next(scratch_.valid_masks_.begin(), pos)->second.first >> i) & 1) == 1 ?
             BM_1 : BM_0);
     y.bitmasks[i] = (
-        ((std::next(valid_masks_.begin(), pos)->second.second >> i) & 1) == 1 ?
+        ((std::next(scratch_.valid_masks_.begin(), pos)->second.second >> i) & 1) == 1 ?
             BM_1 : BM_0);
   }
 
-  if (std::next(valid_masks_.begin(), pos)->second.first)
+  if (std::next(scratch_.valid_masks_.begin(), pos)->second.first)
     is_active_ = true;
   else
     is_active_ = false;
@@ -327,54 +409,55 @@ int NonlinearStep<bitsize>::TakeBestBox(
   x.reinit_caremask();
   y.reinit_caremask();
 
-  return valid_masks_.size();
+  return scratch_.valid_masks_.size();
 }
 
 template<unsigned bitsize>
 void NonlinearStep<bitsize>::TakeBestBoxRandom(
     Mask& x, Mask& y, std::function<int(int, int, int)> rating) {
-  inmasks_.clear();
-  outmasks_.clear();
-  create_masks(inmasks_, x);
-  create_masks(outmasks_, y);
-  valid_masks_.clear();
+  TRACE_SCOPE("NonlinearStep::TakeBestBoxRandom");
+  scratch_.inmasks_.clear();
+  scratch_.outmasks_.clear();
+  create_masks(scratch_.inmasks_, x);
+  create_masks(scratch_.outmasks_, y);
+  scratch_.valid_masks_.clear();
 
   //FIXME: not nice, just to be able to set boxes active
   if (has_to_be_active_ == true)
-    for (auto it = inmasks_.begin(); it != inmasks_.end(); ++it)
+    for (auto it = scratch_.inmasks_.begin(); it != scratch_.inmasks_.end(); ++it)
       if (*it == 0) {
-        inmasks_.erase(it);
+        scratch_.inmasks_.erase(it);
         break;
       }
 
-  for (const auto& inmask : inmasks_)
-    for (const auto& outmask : outmasks_) {
+  for (const auto& inmask : scratch_.inmasks_)
+    for (const auto& outmask : scratch_.outmasks_) {
       if (ldt_->ldt[inmask][outmask] != 0) {
-        valid_masks_.insert(
+        scratch_.valid_masks_.insert(
             std::pair<int, std::pair<unsigned int, unsigned int>>(
-                rating(ldt_->ldt[inmask][outmask], __builtin_popcount(inmask),
-                       __builtin_popcount(outmask)),
+                Rate(rating, inmask, outmask),
                 std::pair<unsigned int, unsigned int>(inmask, outmask)));
       }
     }
 
-  assert(valid_masks_.rbegin() != valid_masks_.rend());
-  auto iterators = valid_masks_.equal_range(valid_masks_.begin()->first);
-  std::mt19937 generator(
-        std::chrono::high_resolution_clock::now().time_since_epoch().count());
+  assert(scratch_.valid_masks_.rbegin() != scratch_.valid_masks_.rend());
+  auto iterators = scratch_.valid_masks_.equal_range(scratch_.valid_masks_.begin()->first);
   std::uniform_int_distribution<int> guessbox(0, std::distance(iterators.first, iterators.second) - 1);
-  int box = guessbox(generator);
+  int box = guessbox(Random::Generator());
+  if (GuessTrace::Current() != nullptr)
+    box = GuessTrace::Current()->Pick(
+        std::distance(iterators.first, iterators.second), box);
 
   for (unsigned int i = 0; i < bitsize; ++i) {
     x.bitmasks[i] = (
-        ((std::next(valid_masks_.begin(), box)->second.first >> i) & 1) == 1 ?
+        ((std::next(scratch_.valid_masks_.begin(), box)->second.first >> i) & 1) == 1 ?
             BM_1 : BM_0);
     y.bitmasks[i] = (
-        ((std::next(valid_masks_.begin(), box)->second.second >> i) & 1) == 1 ?
+        ((std::next(scratch_.valid_masks_.begin(), box)->second.second >> i) & 1) == 1 ?
             BM_1 : BM_0);
   }
 
-  if (std::next(valid_masks_.begin(), box)->second.first)
+  if (std::next(scratch_.valid_masks_.begin(), box)->second.first)
     is_active_ = true;
   else
     is_active_ = false;
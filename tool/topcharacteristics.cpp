@@ -0,0 +1,107 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "topcharacteristics.h"
+
+#include <algorithm>
+
+static bool WorseEntry(const TopEntry& a, const TopEntry& b) {
+  return a.bias_ > b.bias_;
+}
+
+TopCharacteristics::TopCharacteristics(unsigned int capacity)
+    : capacity_(capacity) {
+}
+
+bool TopCharacteristics::Enabled() const {
+  return capacity_ > 0;
+}
+
+bool TopCharacteristics::Add(double bias, Permutation* perm) {
+  if (Enabled() == false)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (heap_.size() == capacity_ && bias <= heap_.front().bias_)
+    return false;
+
+  StateHash hash = perm->hash();
+  for (const TopEntry& entry : heap_)
+    if (entry.hash_.key_ == hash.key_ && entry.hash_.check_ == hash.check_)
+      return false;
+
+  // the worst characteristic is on top of the heap and replaced first
+  if (heap_.size() == capacity_) {
+    std::pop_heap(heap_.begin(), heap_.end(), WorseEntry);
+    heap_.pop_back();
+  }
+  heap_.push_back(TopEntry { bias, hash, perm->clone() });
+  std::push_heap(heap_.begin(), heap_.end(), WorseEntry);
+  return true;
+}
+
+static std::vector<const TopEntry*> SortedEntries(
+    const std::vector<TopEntry>& heap) {
+  std::vector<const TopEntry*> sorted;
+  for (const TopEntry& entry : heap)
+    sorted.push_back(&entry);
+  std::sort(sorted.begin(), sorted.end(),
+            [] (const TopEntry* a, const TopEntry* b) {
+              return a->bias_ > b->bias_;
+            });
+  return sorted;
+}
+
+void TopCharacteristics::Print(std::ostream& stream) {
+  if (Enabled() == false)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<const TopEntry*> sorted = SortedEntries(heap_);
+
+  stream << "PRINT-TOP: " << sorted.size() << " best characteristics"
+         << std::endl;
+  for (unsigned int i = 0; i < sorted.size(); ++i) {
+    stream << "top: " << i + 1 << ", bias: " << sorted[i]->bias_ << std::endl;
+    sorted[i]->perm_->PrintWithProbability(stream);
+  }
+}
+
+std::vector<std::unique_ptr<Permutation>> TopCharacteristics::Characteristics() {
+  // copies of the characteristics, the best one first
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::unique_ptr<Permutation>> characteristics;
+  for (const TopEntry* entry : SortedEntries(heap_))
+    characteristics.emplace_back(entry->perm_->clone());
+  return characteristics;
+}
+
+std::vector<double> TopCharacteristics::Biases() {
+  // in the order of Characteristics
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<double> biases;
+  for (const TopEntry* entry : SortedEntries(heap_))
+    biases.push_back(entry->bias_);
+  return biases;
+}
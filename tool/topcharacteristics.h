@@ -0,0 +1,60 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef TOPCHARACTERISTICS_H_
+#define TOPCHARACTERISTICS_H_
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+#include "permutation.h"
+#include "statehash.h"
+
+struct TopEntry {
+  double bias_;
+  StateHash hash_;
+  std::unique_ptr<Permutation> perm_;
+};
+
+// the best distinct characteristics found by a search, a min-heap on the
+// bias with at most capacity entries
+struct TopCharacteristics {
+  TopCharacteristics(unsigned int capacity);
+  bool Enabled() const;
+  bool Add(double bias, Permutation* perm);
+  void Print(std::ostream& stream);
+  std::vector<std::unique_ptr<Permutation>> Characteristics();
+  std::vector<double> Biases();
+
+ private:
+  std::mutex mutex_;
+  unsigned int capacity_;
+  std::vector<TopEntry> heap_;
+};
+
+#endif /* TOPCHARACTERISTICS_H_ */
@@ -0,0 +1,175 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include "trace.h"
+
+#ifdef TRACE
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// the histograms of one thread, one vector of sites per target
+struct TraceThread {
+  std::vector<std::vector<TraceHistogram>> targets_;
+};
+
+// owns the histograms of all threads and prints them at exit, after the
+// thread_local pointers to them are gone
+struct TraceRegistry {
+  ~TraceRegistry();
+
+  std::mutex mutex_;
+  std::vector<const char*> sites_;
+  std::vector<std::string> targets_ { "" };
+  std::vector<std::unique_ptr<TraceThread>> threads_;
+};
+
+TraceRegistry& Registry() {
+  static TraceRegistry registry;
+  return registry;
+}
+
+thread_local TraceThread* local_thread = nullptr;
+// the target set by the thread itself, batch runs a search file per thread
+thread_local int thread_target = -1;
+
+// the smallest power of two above the given share of the calls
+uint64_t Percentile(const TraceHistogram& histogram, double share) {
+  uint64_t calls = 0;
+  for (unsigned int b = 0; b < TRACE_BUCKETS; ++b) {
+    calls += histogram.buckets_[b];
+    if (calls >= share * histogram.calls_)
+      return 1ULL << b;
+  }
+  return 1ULL << (TRACE_BUCKETS - 1);
+}
+
+TraceRegistry::~TraceRegistry() {
+  // instances of a template have a site each, they are merged by name
+  std::map<std::string, std::map<std::string, TraceHistogram>> merged;
+  for (auto& thread : threads_)
+    for (unsigned int t = 0; t < thread->targets_.size(); ++t)
+      for (unsigned int s = 0; s < thread->targets_[t].size(); ++s) {
+        const TraceHistogram& from = thread->targets_[t][s];
+        if (from.calls_ == 0)
+          continue;
+        TraceHistogram& to = merged[targets_[t]][sites_[s]];
+        for (unsigned int b = 0; b < TRACE_BUCKETS; ++b)
+          to.buckets_[b] += from.buckets_[b];
+        to.calls_ += from.calls_;
+        to.cycles_ += from.cycles_;
+        to.max_ = std::max(to.max_, from.max_);
+      }
+
+  for (auto& target : merged) {
+    std::cerr << "TRACE: "
+              << (target.first.empty() ? "no permutation" : target.first)
+              << " (cycles)" << std::endl;
+    std::cerr << std::left << std::setw(36) << "function" << std::right
+              << std::setw(12) << "calls" << std::setw(12) << "mean"
+              << std::setw(12) << "p50 <" << std::setw(12) << "p99 <"
+              << std::setw(14) << "max" << std::endl;
+    for (auto& site : target.second) {
+      const TraceHistogram& histogram = site.second;
+      std::cerr << std::left << std::setw(36) << site.first << std::right
+                << std::setw(12) << histogram.calls_ << std::setw(12)
+                << histogram.cycles_ / histogram.calls_ << std::setw(12)
+                << Percentile(histogram, 0.5) << std::setw(12)
+                << Percentile(histogram, 0.99) << std::setw(14)
+                << histogram.max_ << std::endl;
+    }
+  }
+}
+
+}  // namespace
+
+std::atomic<unsigned int> Trace::target_(0);
+
+TraceHistogram::TraceHistogram()
+    : buckets_(),
+      calls_(0),
+      cycles_(0),
+      max_(0) {
+}
+
+TraceSite::TraceSite(const char* name)
+    : name_(name),
+      id_(Trace::Register(name)) {
+}
+
+unsigned int Trace::Register(const char* name) {
+  TraceRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.sites_.push_back(name);
+  return registry.sites_.size() - 1;
+}
+
+void Trace::SetTarget(const std::string& target) {
+  TraceRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  unsigned int id = 0;
+  while (id < registry.targets_.size() && registry.targets_[id] != target)
+    ++id;
+  if (id == registry.targets_.size())
+    registry.targets_.push_back(target);
+  target_.store(id, std::memory_order_relaxed);
+  thread_target = id;
+}
+
+std::vector<TraceHistogram>& Trace::Local(unsigned int target) {
+  if (local_thread == nullptr) {
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    registry.threads_.emplace_back(new TraceThread());
+    local_thread = registry.threads_.back().get();
+  }
+  if (target >= local_thread->targets_.size())
+    local_thread->targets_.resize(target + 1);
+  return local_thread->targets_[target];
+}
+
+void Trace::Record(unsigned int site, uint64_t cycles) {
+  std::vector<TraceHistogram>& sites = Local(thread_target >= 0
+      ? thread_target : target_.load(std::memory_order_relaxed));
+  if (site >= sites.size())
+    sites.resize(site + 1);
+  TraceHistogram& histogram = sites[site];
+  unsigned int bucket = cycles ? 64 - __builtin_clzll(cycles) : 0;
+  ++histogram.buckets_[bucket < TRACE_BUCKETS ? bucket : TRACE_BUCKETS - 1];
+  ++histogram.calls_;
+  histogram.cycles_ += cycles;
+  if (cycles > histogram.max_)
+    histogram.max_ = cycles;
+}
+
+#endif
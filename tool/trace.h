@@ -0,0 +1,112 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+// latency histograms of the hot functions, which are only compiled in with
+// -DTRACE (make trace), without it TRACE_SCOPE and TRACE_TARGET are empty
+#ifdef TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#define TRACE_BUCKETS 48
+
+// bucket b counts the calls which took less than 2^b cycles
+struct TraceHistogram {
+  TraceHistogram();
+
+  uint64_t buckets_[TRACE_BUCKETS];
+  uint64_t calls_;
+  uint64_t cycles_;
+  uint64_t max_;
+};
+
+// one TRACE_SCOPE in the code
+struct TraceSite {
+  TraceSite(const char* name);
+
+  const char* name_;
+  unsigned int id_;
+};
+
+struct Trace {
+  static uint64_t Now();
+  static unsigned int Register(const char* name);
+  // the permutation the calling thread records for, threads which never set
+  // one record for the last one set by any thread
+  static void SetTarget(const std::string& target);
+  static void Record(unsigned int site, uint64_t cycles);
+
+ private:
+  static std::vector<TraceHistogram>& Local(unsigned int target);
+
+  static std::atomic<unsigned int> target_;
+};
+
+struct TraceScope {
+  TraceScope(const TraceSite& site) : site_(site.id_), start_(Trace::Now()) {}
+  ~TraceScope() { Trace::Record(site_, Trace::Now() - start_); }
+
+  unsigned int site_;
+  uint64_t start_;
+};
+
+inline uint64_t Trace::Now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#define TRACE_CONCAT_(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+  static TraceSite TRACE_CONCAT(trace_site_, __LINE__)(name); \
+  TraceScope TRACE_CONCAT(trace_scope_, __LINE__)( \
+      TRACE_CONCAT(trace_site_, __LINE__))
+#define TRACE_TARGET(target) Trace::SetTarget(target)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_TARGET(target)
+
+#endif
+
+#endif /* TRACE_H_ */
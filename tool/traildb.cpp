@@ -0,0 +1,209 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "traildb.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+#define TRAILDB_MAGIC   0x3242444c  // "LDB2"
+
+namespace {
+
+template <typename T>
+void Put(std::ostream& stream, T value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool Get(std::istream& stream, T& value) {
+  return (bool) stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}  // namespace
+
+TrailDatabase::TrailDatabase(const std::string& filename,
+                             const std::string& config)
+    : filename_(filename),
+      config_(config),
+      open_(false),
+      end_(0) {
+}
+
+bool TrailDatabase::Enabled() const {
+  return filename_.empty() == false;
+}
+
+bool TrailDatabase::Open() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (open_)
+    return true;
+
+  // a new log starts with the configuration it belongs to
+  std::ifstream log(filename_, std::ios::binary);
+  if (log.is_open() == false) {
+    std::ofstream created(filename_, std::ios::binary);
+    Put<uint32_t>(created, TRAILDB_MAGIC);
+    Put<uint32_t>(created, config_.size());
+    created.write(config_.data(), config_.size());
+    std::ofstream index(filename_ + ".idx", std::ios::binary | std::ios::trunc);
+    if (created.good() == false || index.good() == false) {
+      std::cout << "Cannot create the trail database " << filename_
+                << std::endl;
+      return false;
+    }
+    end_ = sizeof(uint32_t) * 2 + config_.size();
+    open_ = true;
+    return true;
+  }
+  uint32_t magic = 0, size = 0;
+  Get(log, magic);
+  Get(log, size);
+  std::string config(size, ' ');
+  log.read(&config[0], size);
+  if (magic != TRAILDB_MAGIC || config != config_) {
+    std::cout << "The trail database " << filename_ << " belongs to "
+              << (magic == TRAILDB_MAGIC ? config : "no permutation")
+              << std::endl;
+    return false;
+  }
+  end_ = sizeof(uint32_t) * 2 + config_.size();
+
+  // the index covers the records up to the last one it names, the rest of
+  // the log is scanned
+  std::ifstream index(filename_ + ".idx", std::ios::binary);
+  uint64_t key, check, offset;
+  while (Get(index, key) && Get(index, check) && Get(index, offset)) {
+    index_[std::make_pair(key, check)] = offset;
+    end_ = std::max(end_, offset);
+  }
+  open_ = Scan();
+  return open_;
+}
+
+bool TrailDatabase::Scan() {
+  std::ifstream log(filename_, std::ios::binary);
+  std::ofstream index(filename_ + ".idx", std::ios::binary | std::ios::app);
+  log.seekg(end_);
+  uint64_t key, check;
+  StoredTrail trail;
+  uint64_t offset = end_;
+  while (ReadRecord(log, key, check, trail)) {
+    if (index_.count(std::make_pair(key, check)) == 0) {
+      index_[std::make_pair(key, check)] = offset;
+      Put(index, key);
+      Put(index, check);
+      Put(index, offset);
+    }
+    offset = log.tellg();
+  }
+  end_ = offset;
+
+  // a record which was cut off by a crash is overwritten by the next one
+  log.close();
+  if (truncate(filename_.c_str(), end_) != 0) {
+    std::cout << "Cannot truncate the trail database " << filename_
+              << std::endl;
+    return false;
+  }
+  return index.good();
+}
+
+bool TrailDatabase::ReadRecord(std::istream& stream, uint64_t& key,
+                               uint64_t& check, StoredTrail& trail) const {
+  uint32_t words = 0;
+  if ((Get(stream, key) && Get(stream, check) && Get(stream, trail.rounds_)
+      && Get(stream, trail.bias_) && Get(stream, words)) == false)
+    return false;
+  trail.planes_.resize(words);
+  for (auto& plane : trail.planes_)
+    if ((Get(stream, plane.first) && Get(stream, plane.second)) == false)
+      return false;
+  return true;
+}
+
+bool TrailDatabase::Add(double bias, Permutation* perm) {
+  if (Enabled() == false || Open() == false)
+    return false;
+
+  // all rotated copies of a characteristic have the same key
+  std::unique_ptr<Permutation> canonical = perm->clone();
+  canonical->canonical_ = true;
+  StateHash hash = canonical->hash();
+  StoredTrail trail { perm->rounds_, bias, { } };
+  perm->GetPlanes(trail.planes_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_.count(std::make_pair(hash.key_, hash.check_)))
+    return false;
+  std::ofstream log(filename_, std::ios::binary | std::ios::in);
+  log.seekp(end_);
+  Put(log, hash.key_);
+  Put(log, hash.check_);
+  Put(log, trail.rounds_);
+  Put(log, trail.bias_);
+  Put<uint32_t>(log, trail.planes_.size());
+  for (const auto& plane : trail.planes_) {
+    Put(log, plane.first);
+    Put(log, plane.second);
+  }
+  log.flush();
+  if (log.good() == false)
+    return false;
+
+  // the record is in the log before it is indexed
+  std::ofstream index(filename_ + ".idx", std::ios::binary | std::ios::app);
+  Put(index, hash.key_);
+  Put(index, hash.check_);
+  Put(index, end_);
+  index_[std::make_pair(hash.key_, hash.check_)] = end_;
+  end_ = log.tellp();
+  return index.good();
+}
+
+bool TrailDatabase::Read(unsigned int rounds,
+                         std::vector<StoredTrail>& trails) {
+  if (Enabled() == false || Open() == false)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ifstream log(filename_, std::ios::binary);
+  uint64_t key, check;
+  StoredTrail trail;
+  trails.clear();
+  for (const auto& entry : index_) {
+    log.seekg(entry.second);
+    if (ReadRecord(log, key, check, trail) && trail.rounds_ == rounds)
+      trails.push_back(trail);
+  }
+  return true;
+}
+
+size_t TrailDatabase::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size();
+}
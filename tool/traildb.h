@@ -0,0 +1,68 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef TRAILDB_H_
+#define TRAILDB_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+#include "permutation.h"
+
+struct StoredTrail {
+  uint32_t rounds_;
+  double bias_;
+  MaskPlanes planes_;
+};
+
+// the characteristics of all runs on one permutation with any number of
+// rounds, an append-only log of records and an index file of the hashes of
+// their masks, rotated copies are stored once
+struct TrailDatabase {
+  TrailDatabase(const std::string& filename, const std::string& config);
+  bool Enabled() const;
+  bool Open();
+  bool Add(double bias, Permutation* perm);
+  bool Read(unsigned int rounds, std::vector<StoredTrail>& trails);
+  size_t size();
+
+ private:
+  bool ReadRecord(std::istream& stream, uint64_t& key, uint64_t& check,
+                  StoredTrail& trail) const;
+  bool Scan();
+
+  std::mutex mutex_;
+  std::string filename_;
+  std::string config_;
+  bool open_;
+  uint64_t end_;  // end of the last complete record of the log
+  std::map<std::pair<uint64_t, uint64_t>, uint64_t> index_;
+};
+
+#endif /* TRAILDB_H_ */
@@ -0,0 +1,181 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "trailwriter.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+#define TRAIL_RECORD_MAGIC   0x3152544c  // "LTR1"
+
+namespace {
+
+template <typename T>
+void Put(std::ostream& stream, T value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+std::string Escape(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+}  // namespace
+
+TrailWriter::TrailWriter(const std::string& format,
+                         const std::string& filename,
+                         const std::string& permutation,
+                         std::ostream& out)
+    : format_(-1),
+      permutation_(permutation),
+      stream_(&out),
+      queue_(256) {
+  if (format == "text")
+    format_ = FORMAT_TEXT;
+  else if (format == "jsonl")
+    format_ = FORMAT_JSONL;
+  else if (format == "binary")
+    format_ = FORMAT_BINARY;
+  if (Valid() == false || Text())
+    return;
+
+  if (filename.empty() == false && filename != "-") {
+    file_.open(filename, std::ios::binary | std::ios::app);
+    if (file_.is_open() == false) {
+      out << "Cannot open the output " << filename << std::endl;
+      format_ = -1;
+      return;
+    }
+    stream_ = &file_;
+  }
+  writer_ = std::thread(&TrailWriter::Run, this);
+}
+
+TrailWriter::~TrailWriter() {
+  if (writer_.joinable()) {
+    queue_.Close();
+    writer_.join();
+  }
+}
+
+bool TrailWriter::Valid() const {
+  return format_ >= 0;
+}
+
+bool TrailWriter::Text() const {
+  return format_ == FORMAT_TEXT;
+}
+
+void TrailWriter::Write(const std::string& label, double bias,
+                        Permutation* perm) {
+  if (Valid() == false)
+    return;
+  if (Text()) {
+    *stream_ << label << std::endl;
+    perm->PrintWithProbability(*stream_);
+    return;
+  }
+
+  // the search thread only copies the masks
+  std::unique_ptr<TrailRecord> record(new TrailRecord());
+  record->label_ = label;
+  record->rounds_ = perm->rounds_;
+  record->bias_ = bias;
+  record->active_ = perm->GetActiveSboxes();
+  record->bits_ = perm->state_masks_[0]->getnumbits();
+  for (auto& state : perm->state_masks_)
+    record->words_.push_back(state->getnumwords());
+  perm->GetPlanes(record->planes_);
+
+  queue_.Push(std::move(record));
+}
+
+void TrailWriter::Run() {
+  // the output is flushed whenever the writer caught up with the searches,
+  // the records queued before the end are written as well
+  std::unique_ptr<TrailRecord> record;
+  while (queue_.Pop(record)) {
+    Format(*record);
+    if (queue_.Empty())
+      stream_->flush();
+  }
+  stream_->flush();
+}
+
+void TrailWriter::Format(const TrailRecord& record) {
+  std::ostream& stream = *stream_;
+  if (format_ == FORMAT_BINARY) {
+    Put<uint32_t>(stream, TRAIL_RECORD_MAGIC);
+    Put<uint32_t>(stream, record.label_.size());
+    stream.write(record.label_.data(), record.label_.size());
+    Put<uint32_t>(stream, record.rounds_);
+    Put<double>(stream, record.bias_);
+    Put<uint32_t>(stream, record.active_);
+    Put<uint32_t>(stream, record.bits_);
+    Put<uint32_t>(stream, record.words_.size());
+    for (unsigned int words : record.words_)
+      Put<uint32_t>(stream, words);
+    for (const auto& plane : record.planes_) {
+      Put<uint64_t>(stream, plane.first & plane.second);
+      Put<uint64_t>(stream, plane.second);
+    }
+    return;
+  }
+
+  // the masks and the fixed bits of each state as hex words, undetermined
+  // bits are 0 in the mask and in care
+  unsigned int digits = (record.bits_ + 3) / 4;
+  BitVector all = record.bits_ >= 64 ? ~0ULL : (1ULL << record.bits_) - 1;
+  std::string masks, care;
+  char word[17];
+  unsigned int i = 0;
+  for (unsigned int state = 0; state < record.words_.size(); ++state) {
+    masks += state ? ",\"" : "\"";
+    care += state ? ",\"" : "\"";
+    for (unsigned int w = 0; w < record.words_[state]; ++w, ++i) {
+      const auto& plane = record.planes_[i];
+      std::snprintf(word, sizeof(word), "%0*llx", digits,
+                    (unsigned long long) (plane.first & plane.second & all));
+      masks += word;
+      std::snprintf(word, sizeof(word), "%0*llx", digits,
+                    (unsigned long long) (plane.second & all));
+      care += word;
+    }
+    masks += "\"";
+    care += "\"";
+  }
+  stream << "{\"permutation\":\"" << Escape(permutation_) << "\",\"rounds\":"
+         << record.rounds_ << ",\"label\":\"" << Escape(record.label_)
+         << "\",\"bias\":" << std::setprecision(17) << record.bias_
+         << ",\"active\":" << record.active_
+         << ",\"masks\":[" << masks << "],\"care\":[" << care << "]}\n";
+}
@@ -0,0 +1,133 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef TRAILWRITER_H_
+#define TRAILWRITER_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <ostream>
+
+#include "permutation.h"
+
+// bounded queue for any number of producer and consumer threads, a full
+// queue blocks the producers and an empty one the consumers until it is
+// closed
+template <typename T>
+struct BlockingQueue {
+  BlockingQueue(size_t capacity)
+      : capacity_(capacity),
+        closed_(false) {
+  }
+
+  void Push(T&& value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.push_back(std::move(value));
+    lock.unlock();
+    not_empty_.notify_one();
+  }
+
+  // false once the queue is closed and empty
+  bool Pop(T& value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return items_.size() || closed_; });
+    if (items_.empty())
+      return false;
+    value = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  bool Empty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.empty();
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+  }
+
+ private:
+  size_t capacity_;
+  bool closed_;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+#define FORMAT_TEXT    0
+#define FORMAT_JSONL   1
+#define FORMAT_BINARY  2
+
+// a copy of the masks of a reported characteristic, formatted by the writer
+struct TrailRecord {
+  std::string label_;
+  unsigned int rounds_;
+  double bias_;
+  unsigned int active_;
+  std::vector<unsigned int> words_;  // words of each state
+  unsigned int bits_;                // bits of a word
+  MaskPlanes planes_;
+};
+
+// writes the reported characteristics, text is printed right away as before,
+// JSON Lines and binary records are formatted and written by a background
+// thread which gets copies of the masks through a queue
+struct TrailWriter {
+  TrailWriter(const std::string& format, const std::string& filename,
+              const std::string& permutation, std::ostream& out = std::cout);
+  ~TrailWriter();
+  bool Valid() const;
+  bool Text() const;
+  void Write(const std::string& label, double bias, Permutation* perm);
+
+ private:
+  void Run();
+  void Format(const TrailRecord& record);
+
+  int format_;
+  std::string permutation_;
+  std::ofstream file_;
+  std::ostream* stream_;
+  BlockingQueue<std::unique_ptr<TrailRecord>> queue_;
+  std::thread writer_;
+};
+
+#endif /* TRAILWRITER_H_ */
@@ -0,0 +1,355 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "truncated.h"
+
+#include <set>
+
+TruncatedModel::TruncatedModel(Permutation* perm)
+    : supported_(true),
+      first_layer_(0),
+      last_layer_(perm->sbox_layers_.size() - 1) {
+  for (unsigned int layer = 0; layer < perm->sbox_layers_.size(); ++layer) {
+    layer_offset_.push_back(boxes_.size());
+    for (unsigned int pos = 0; pos < perm->sbox_layers_[layer]->GetNumSteps();
+        ++pos)
+      boxes_.emplace_back(layer, pos);
+  }
+
+  // only linear layers between two S-box layers restrict the activity
+  for (unsigned int linear = 0; linear < perm->linear_layers_.size();
+      ++linear) {
+    int in_layer = -1, out_layer = -1;
+    for (unsigned int layer = 0; layer < perm->sbox_layers_.size(); ++layer) {
+      if (perm->sbox_layers_[layer]->out == perm->linear_layers_[linear]->in)
+        in_layer = layer;
+      if (perm->sbox_layers_[layer]->in == perm->linear_layers_[linear]->out)
+        out_layer = layer;
+    }
+    if (in_layer >= 0 && out_layer >= 0)
+      AddRules(perm, linear, in_layer, out_layer);
+  }
+}
+
+bool TruncatedModel::Supported() const {
+  return supported_;
+}
+
+unsigned int TruncatedModel::getNumBoxes() const {
+  return boxes_.size();
+}
+
+SboxPos TruncatedModel::getBox(unsigned int index) const {
+  return boxes_[index];
+}
+
+unsigned int TruncatedModel::getNumLayers() const {
+  return layer_offset_.size();
+}
+
+unsigned int TruncatedModel::getLayerBegin(unsigned int layer) const {
+  return layer_offset_[layer];
+}
+
+unsigned int TruncatedModel::getLayerEnd(unsigned int layer) const {
+  return layer + 1 < layer_offset_.size() ?
+      layer_offset_[layer + 1] : boxes_.size();
+}
+
+void TruncatedModel::Restrict(unsigned int first, unsigned int last) {
+  first_layer_ = first;
+  last_layer_ = last;
+}
+
+void TruncatedModel::InitPattern(Permutation* perm,
+                                 ActivityPattern& pattern) const {
+  pattern.resize(boxes_.size());
+  for (unsigned int i = 0; i < boxes_.size(); ++i) {
+    SboxLayerBase* layer = perm->sbox_layers_[boxes_[i].layer_].get();
+    if (layer->SboxActive(boxes_[i].pos_))
+      pattern[i] = TR_ACTIVE;
+    else if (layer->SboxGuessable(boxes_[i].pos_) == false)
+      pattern[i] = TR_INACTIVE;
+    else
+      pattern[i] = TR_DUNNO;
+  }
+}
+
+bool TruncatedModel::Propagate(ActivityPattern& pattern,
+                               unsigned int max_active) const {
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+    for (const Rule& rule : rules_) {
+      if (pattern[rule.box] == TR_INACTIVE || rule.box_layer < first_layer_
+          || rule.box_layer > last_layer_ || rule.reach_layer < first_layer_
+          || rule.reach_layer > last_layer_)
+        continue;
+      unsigned int dunno = 0, last = 0;
+      bool reached = false;
+      for (unsigned int box : rule.reach) {
+        if (pattern[box] == TR_ACTIVE) {
+          reached = true;
+          break;
+        }
+        if (pattern[box] == TR_DUNNO) {
+          dunno++;
+          last = box;
+        }
+      }
+      if (reached)
+        continue;
+      if (dunno == 0) {
+        if (pattern[rule.box] == TR_ACTIVE)
+          return false;
+        pattern[rule.box] = TR_INACTIVE;
+        changed = true;
+      } else if (dunno == 1 && pattern[rule.box] == TR_ACTIVE) {
+        pattern[last] = TR_ACTIVE;
+        changed = true;
+      }
+    }
+
+    // the linear layers are bijective, so every S-box layer of a nonzero
+    // characteristic has an active box
+    unsigned int total_active = 0;
+    for (unsigned int layer = first_layer_; layer <= last_layer_; ++layer) {
+      unsigned int active = 0, dunno = 0, last = 0;
+      for (unsigned int box = getLayerBegin(layer); box < getLayerEnd(layer);
+          ++box) {
+        if (pattern[box] == TR_ACTIVE)
+          active++;
+        if (pattern[box] == TR_DUNNO) {
+          dunno++;
+          last = box;
+        }
+      }
+      if (active == 0 && dunno == 0)
+        return false;
+      if (active == 0 && dunno == 1) {
+        pattern[last] = TR_ACTIVE;
+        active++;
+        changed = true;
+      }
+      total_active += active;
+    }
+
+    if (max_active == 0 || total_active < max_active)
+      continue;
+    if (total_active > max_active)
+      return false;
+    for (unsigned int box = getLayerBegin(first_layer_);
+        box < getLayerEnd(last_layer_); ++box)
+      if (pattern[box] == TR_DUNNO) {
+        pattern[box] = TR_INACTIVE;
+        changed = true;
+      }
+  }
+  return true;
+}
+
+bool TruncatedModel::Apply(ActivityPattern& pattern, Permutation* perm) const {
+  bool changed = false;
+  for (unsigned int i = 0; i < boxes_.size(); ++i) {
+    SboxLayerBase* layer = perm->sbox_layers_[boxes_[i].layer_].get();
+    if (pattern[i] == TR_ACTIVE && layer->SboxActive(boxes_[i].pos_) == false) {
+      layer->SetSboxActive(boxes_[i].pos_, true);
+      perm->touchall();
+      changed = true;
+    } else if (pattern[i] == TR_INACTIVE
+        && layer->SboxGuessable(boxes_[i].pos_)) {
+      if (perm->setBoxInactive(boxes_[i]) == false)
+        return false;
+      changed = true;
+    }
+  }
+  if (changed && perm->update() == false)
+    return false;
+
+  // an active box has nonzero masks, the propagation of a single box does not
+  // know that, so the last undetermined bit of its masks is set here
+  bool set = true;
+  while (set) {
+    set = false;
+    for (unsigned int i = 0; i < boxes_.size(); ++i)
+      if (pattern[i] == TR_ACTIVE)
+        set |= SetLastBit(perm, boxes_[i]);
+    if (set) {
+      perm->touchall();
+      if (perm->update() == false)
+        return false;
+    }
+  }
+
+  // the bit level propagation may decide the activity of further boxes
+  for (unsigned int i = 0; i < boxes_.size(); ++i) {
+    SboxLayerBase* layer = perm->sbox_layers_[boxes_[i].layer_].get();
+    if (layer->SboxActive(boxes_[i].pos_)) {
+      if (pattern[i] == TR_INACTIVE)
+        return false;
+      pattern[i] = TR_ACTIVE;
+    } else if (layer->SboxGuessable(boxes_[i].pos_) == false) {
+      pattern[i] = TR_INACTIVE;
+    }
+  }
+  return true;
+}
+
+bool TruncatedModel::SetLastBit(Permutation* perm, SboxPos pos) const {
+  SboxLayerBase* layer = perm->sbox_layers_[pos.layer_].get();
+  bool changed = false;
+  for (StateMaskBase* state : { layer->in, layer->out }) {
+    Mask mask(layer->GetVerticalMask(pos.pos_, *state));
+    unsigned int dunno = 0, last = 0;
+    bool set = false;
+    for (unsigned int i = 0; i < mask.bitmasks.size(); ++i) {
+      set |= mask.bitmasks[i] == BM_1;
+      if (mask.bitmasks[i] == BM_DUNNO) {
+        dunno++;
+        last = i;
+      }
+    }
+    if (set == false && dunno == 1) {
+      mask.set_bit(BM_1, last);
+      layer->SetVerticalMask(pos.pos_, *state, mask);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+std::vector<int> TruncatedModel::BoxOfBit(Permutation* perm,
+                                          unsigned int layer,
+                                          StateMaskBase* state) const {
+  SboxLayerBase* sbox_layer = perm->sbox_layers_[layer].get();
+  unsigned int bits = state->getnumbits();
+  std::vector<int> box_of_bit(state->getnumwords() * bits, -1);
+  std::unique_ptr<StateMaskBase> scratch(state->clone());
+
+  // the bits of a box are the ones set by a vertical mask of ones
+  for (unsigned int box = 0; box < sbox_layer->GetNumSteps(); ++box) {
+    scratch->SetState(BM_0);
+    Mask mask = sbox_layer->GetVerticalMask(box, *scratch);
+    for (unsigned int i = 0; i < mask.bitmasks.size(); ++i)
+      mask.set_bit(BM_1, i);
+    sbox_layer->SetVerticalMask(box, *scratch, mask);
+    for (unsigned int w = 0; w < scratch->getnumwords(); ++w)
+      for (unsigned int t = 0; t < bits; ++t)
+        if ((*scratch)[w].bitmasks[t] == BM_1)
+          box_of_bit[w * bits + t] = box;
+  }
+  return box_of_bit;
+}
+
+void TruncatedModel::AddRules(Permutation* perm, unsigned int linear,
+                              int in_layer, int out_layer) {
+  LinearLayer* linear_layer = perm->linear_layers_[linear].get();
+  unsigned int words = linear_layer->in->getnumwords();
+  unsigned int bits = linear_layer->in->getnumbits();
+  unsigned int n = words * bits;
+  unsigned int row_words = (n + 63) / 64;
+  std::vector<int> in_box = BoxOfBit(perm, in_layer, linear_layer->in);
+  std::vector<int> out_box = BoxOfBit(perm, out_layer, linear_layer->out);
+
+  // rows of [M | I], where in_i = <row_i, out>
+  std::vector<uint64_t> rows(n * 2 * row_words, 0);
+  std::vector<BitVector> x(words, 0), y;
+  for (unsigned int i = 0; i < n; ++i) {
+    x[i / bits] = 1ULL << (i % bits);
+    if (linear_layer->Transform(x, y) == false) {
+      supported_ = false;
+      return;
+    }
+    x[i / bits] = 0;
+    uint64_t* row = &rows[i * 2 * row_words];
+    for (unsigned int j = 0; j < n; ++j)
+      if ((y[j / bits] >> (j % bits)) & 1)
+        row[j / 64] |= 1ULL << (j % 64);
+    row[row_words + i / 64] |= 1ULL << (i % 64);
+  }
+
+  std::vector<std::set<unsigned int>> forward(
+      perm->sbox_layers_[in_layer]->GetNumSteps());
+  std::vector<std::set<unsigned int>> backward(
+      perm->sbox_layers_[out_layer]->GetNumSteps());
+
+  // an active input bit reaches the output bits of its row
+  for (unsigned int i = 0; i < n; ++i) {
+    if (in_box[i] < 0)
+      continue;
+    const uint64_t* row = &rows[i * 2 * row_words];
+    for (unsigned int j = 0; j < n; ++j)
+      if (out_box[j] >= 0 && ((row[j / 64] >> (j % 64)) & 1))
+        forward[in_box[i]].insert(out_box[j]);
+  }
+
+  // an active output bit is reached by the input bits of its row of M^-1
+  bool invertible = true;
+  for (unsigned int c = 0; c < n && invertible; ++c) {
+    unsigned int pivot = c;
+    while (pivot < n && ((rows[pivot * 2 * row_words + c / 64] >> (c % 64)) & 1) == 0)
+      ++pivot;
+    if (pivot == n) {
+      invertible = false;
+      break;
+    }
+    if (pivot != c)
+      for (unsigned int k = 0; k < 2 * row_words; ++k)
+        std::swap(rows[pivot * 2 * row_words + k], rows[c * 2 * row_words + k]);
+    const uint64_t* pivot_row = &rows[c * 2 * row_words];
+    for (unsigned int r = 0; r < n; ++r) {
+      uint64_t* row = &rows[r * 2 * row_words];
+      if (r != c && ((row[c / 64] >> (c % 64)) & 1))
+        for (unsigned int k = c / 64; k < 2 * row_words; ++k)
+          row[k] ^= pivot_row[k];
+    }
+  }
+  if (invertible)
+    for (unsigned int j = 0; j < n; ++j) {
+      if (out_box[j] < 0)
+        continue;
+      const uint64_t* row = &rows[j * 2 * row_words + row_words];
+      for (unsigned int i = 0; i < n; ++i)
+        if (in_box[i] >= 0 && ((row[i / 64] >> (i % 64)) & 1))
+          backward[out_box[j]].insert(in_box[i]);
+    }
+
+  for (unsigned int box = 0; box < forward.size(); ++box) {
+    Rule rule { layer_offset_[in_layer] + box, { }, (unsigned int) in_layer,
+        (unsigned int) out_layer };
+    for (unsigned int reach : forward[box])
+      rule.reach.push_back(layer_offset_[out_layer] + reach);
+    rules_.push_back(rule);
+  }
+  for (unsigned int box = 0; box < backward.size() && invertible; ++box) {
+    Rule rule { layer_offset_[out_layer] + box, { }, (unsigned int) out_layer,
+        (unsigned int) in_layer };
+    for (unsigned int reach : backward[box])
+      rule.reach.push_back(layer_offset_[in_layer] + reach);
+    rules_.push_back(rule);
+  }
+}
@@ -0,0 +1,79 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef TRUNCATED_H_
+#define TRUNCATED_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "layer.h"
+#include "permutation.h"
+
+#define TR_DUNNO    -1
+#define TR_INACTIVE  0
+#define TR_ACTIVE    1
+
+typedef std::vector<int8_t> ActivityPattern;  // activity of every S-box
+
+// models a permutation on the level of active S-boxes, a linear layer only
+// tells which boxes of the next layer a box can reach
+struct TruncatedModel {
+  TruncatedModel(Permutation* perm);
+  bool Supported() const;
+  unsigned int getNumBoxes() const;
+  SboxPos getBox(unsigned int index) const;
+  void InitPattern(Permutation* perm, ActivityPattern& pattern) const;
+  unsigned int getNumLayers() const;
+  unsigned int getLayerBegin(unsigned int layer) const;
+  unsigned int getLayerEnd(unsigned int layer) const;
+  void Restrict(unsigned int first, unsigned int last);
+  bool Propagate(ActivityPattern& pattern, unsigned int max_active) const;
+  bool Apply(ActivityPattern& pattern, Permutation* perm) const;
+
+ private:
+  struct Rule {
+    unsigned int box;                 // if this box is active,
+    std::vector<unsigned int> reach;  // one of these boxes is active
+    unsigned int box_layer;
+    unsigned int reach_layer;
+  };
+  bool SetLastBit(Permutation* perm, SboxPos pos) const;
+  std::vector<int> BoxOfBit(Permutation* perm, unsigned int layer,
+                            StateMaskBase* state) const;
+  void AddRules(Permutation* perm, unsigned int linear_layer, int in_layer,
+                int out_layer);
+
+  bool supported_;
+  std::vector<SboxPos> boxes_;
+  std::vector<unsigned int> layer_offset_;
+  std::vector<Rule> rules_;
+  unsigned int first_layer_;  // only the layers first to last are propagated
+  unsigned int last_layer_;
+};
+
+#endif /* TRUNCATED_H_ */
@@ -0,0 +1,158 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#include "tuning.h"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+SettingsBandit::SettingsBandit(const Settings& base, unsigned int arms,
+                               Xoshiro256& generator)
+    : plays_(0) {
+  // the first arm keeps the settings of the configuration file
+  arms_.push_back(TuningArm { base, 0, 0, 0, -DBL_MAX });
+  for (unsigned int i = 1; i < arms; ++i)
+    arms_.push_back(TuningArm { Perturb(base, generator), 0, 0, 0, -DBL_MAX });
+}
+
+unsigned int SettingsBandit::Select() {
+  // every arm is played once before the upper confidence bounds are used
+  for (unsigned int i = 0; i < arms_.size(); ++i)
+    if (arms_[i].plays_ == 0)
+      return i;
+
+  double max_rate = 0;
+  for (const TuningArm& arm : arms_)
+    max_rate = std::max(max_rate, Rate(arm));
+  if (max_rate == 0)
+    max_rate = 1;
+
+  unsigned int selected = 0;
+  double best_bound = -DBL_MAX;
+  for (unsigned int i = 0; i < arms_.size(); ++i) {
+    double bound = Rate(arms_[i]) / max_rate
+        + std::sqrt(2 * std::log(plays_) / arms_[i].plays_);
+    if (bound > best_bound) {
+      best_bound = bound;
+      selected = i;
+    }
+  }
+  return selected;
+}
+
+void SettingsBandit::Update(unsigned int arm, double reward, double seconds,
+                            double bias) {
+  plays_++;
+  arms_[arm].plays_++;
+  arms_[arm].reward_ += reward;
+  arms_[arm].seconds_ += seconds;
+  arms_[arm].best_ = std::max(arms_[arm].best_, bias);
+}
+
+unsigned int SettingsBandit::Best() const {
+  unsigned int best = 0;
+  for (unsigned int i = 1; i < arms_.size(); ++i)
+    if (Rate(arms_[i]) > Rate(arms_[best]))
+      best = i;
+  return best;
+}
+
+void SettingsBandit::PrintStatus(std::ostream& stream) const {
+  for (unsigned int i = 0; i < arms_.size(); ++i) {
+    stream << "PRINT-INFO: arm " << i << ", restarts: " << arms_[i].plays_
+           << ", seconds: " << arms_[i].seconds_
+           << ", log2 reward per second: ";
+    if (Rate(arms_[i]) <= 0)
+      stream << "none";
+    else
+      stream << std::log2(Rate(arms_[i]));
+    stream << ", best: ";
+    if (arms_[i].best_ == -DBL_MAX)
+      stream << "none";
+    else
+      stream << arms_[i].best_;
+    stream << std::endl;
+  }
+}
+
+void SettingsBandit::PrintSettings(std::ostream& stream,
+                                   unsigned int arm) const {
+  stream << "<phase>" << std::endl;
+  for (const Setting& setting : arms_[arm].settings_) {
+    stream << "  <setting push_stack = \"" << setting.push_stack_probability_
+           << "\" alternative_sbox_guesses = \""
+           << setting.alternative_sbox_guesses_
+           << "\" sbox_weight_probability = \""
+           << setting.sbox_weight_probability_
+           << "\" sbox_weight_hamming = \"" << setting.sbox_weight_hamming_
+           << (setting.constrained_first_ ? "\" selection = \"constrained" : "")
+           << "\">" << std::endl;
+    for (unsigned int layer = 0; layer < setting.guess_weights_.size();
+        ++layer)
+      if (setting.guess_weights_[layer][0] != 0
+          || setting.guess_weights_[layer][1] != 0)
+        stream << "    <guess sbox_layer=\"" << layer << "\" active_weight=\""
+               << setting.guess_weights_[layer][1] << "\" inactive_weight=\""
+               << setting.guess_weights_[layer][0] << "\"/>" << std::endl;
+    stream << "  </setting>" << std::endl;
+  }
+  stream << "</phase>" << std::endl;
+}
+
+Settings SettingsBandit::Perturb(const Settings& base,
+                                 Xoshiro256& generator) const {
+  std::lognormal_distribution<float> factor(0.0, 0.7);
+  std::uniform_int_distribution<int> step(-1, 1);
+  Settings settings = base;
+
+  // the values stay in the ranges of the configuration file, where a zero
+  // means the default, and the S-boxes of at most 5 bits have at most 2^10
+  // pairs of masks to guess
+  for (Setting& setting : settings) {
+    setting.push_stack_probability_ = std::min(
+        1.0f, std::max(0.01f, setting.push_stack_probability_ * factor(generator)));
+    setting.alternative_sbox_guesses_ = std::min(1L << 10, std::max(
+        1L, std::lround(setting.alternative_sbox_guesses_ * factor(generator))));
+    setting.sbox_weight_probability_ = std::max(
+        1.0f, setting.sbox_weight_probability_ + step(generator));
+    setting.sbox_weight_hamming_ = std::max(
+        1.0f, setting.sbox_weight_hamming_ + step(generator));
+    // only weights which are used at all are scaled, so the guessed layers
+    // of a setting stay the same
+    for (auto& weights : setting.guess_weights_)
+      for (float& weight : weights)
+        if (weight != 0)
+          weight = std::max(1.0f, std::round(weight * factor(generator)));
+  }
+  return settings;
+}
+
+double SettingsBandit::Rate(const TuningArm& arm) const {
+  if (arm.seconds_ <= 0)
+    return 0;
+  return arm.reward_ / arm.seconds_;
+}
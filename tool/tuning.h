@@ -0,0 +1,66 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef TUNING_H_
+#define TUNING_H_
+
+#include <vector>
+#include <random>
+#include <ostream>
+
+#include "guessmask.h"
+#include "random.h"
+
+// one configuration of the settings and how well restarts with it did
+struct TuningArm {
+  Settings settings_;
+  unsigned int plays_;
+  double reward_;   // sum of the rewards of all restarts
+  double seconds_;  // CPU time spent in restarts
+  double best_;     // best bias found
+};
+
+// chooses the settings of each restart like a multi-armed bandit, where the
+// reward is the bias reached per CPU second
+struct SettingsBandit {
+  SettingsBandit(const Settings& base, unsigned int arms,
+                 Xoshiro256& generator);
+  unsigned int Select();
+  void Update(unsigned int arm, double reward, double seconds, double bias);
+  unsigned int Best() const;
+  void PrintStatus(std::ostream& stream) const;
+  void PrintSettings(std::ostream& stream, unsigned int arm) const;
+
+  std::vector<TuningArm> arms_;
+
+ private:
+  Settings Perturb(const Settings& base, Xoshiro256& generator) const;
+  double Rate(const TuningArm& arm) const;
+
+  unsigned int plays_;
+};
+
+#endif /* TUNING_H_ */